@@ -0,0 +1,1137 @@
+#include <JuceHeader.h>
+#include "Mixer.h"
+#include "ProjectModel.h"
+#include "ProjectJson.h"
+#include "UiStateSync.h"
+#include "VoicePool.h"
+#include "MasterLimiter.h"
+#include "RealTimeLogger.h"
+#include <cstdio>
+#include <iostream>
+#include <thread>
+
+// Engine benchmarks, run headless: MusicMakerBench [options]
+// Every figure is also recorded under a stable name, so a run can be saved as JSON and
+// later runs compared against it to catch regressions.
+namespace
+{
+    double secondsSince (juce::int64 startTicks)
+    {
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    // A session of synth tracks, each holding an 8-note chord for the whole run
+    void addSynthTracks (Mixer& mixer, int numTracks)
+    {
+        mixer.setVoiceBudget (VoicePool::maxBudget); // A fixed budget, so the workload does not depend on the machine
+        for (int t = 0; t < numTracks; ++t)
+        {
+            auto track = std::make_unique<InstrumentTrack> ("Track " + juce::String (t + 1));
+            track->setInstrument (std::make_unique<InternalSynthProcessor>());
+            mixer.addTrack (std::move (track));
+        }
+    }
+
+    void holdChords (Mixer& mixer)
+    {
+        for (int t = 0; t < mixer.getNumTracks(); ++t)
+            for (int k = 0; k < 8; ++k)
+                mixer.getTrack (t)->getScheduledMidi().addEvent (juce::MidiMessage::noteOn (1, 48 + k * 3, 0.8f), 0);
+    }
+
+    // The per-sample voice loop SynthVoice used before its block kernel, kept as the baseline
+    class ReferenceVoice : public juce::SynthesiserVoice
+    {
+    public:
+        bool canPlaySound (juce::SynthesiserSound*) override { return true; }
+
+        void startNote (int midiNoteNumber, float velocity, juce::SynthesiserSound*, int) override
+        {
+            level = velocity * 0.25f;
+            angleDelta = juce::MidiMessage::getMidiNoteInHertz (midiNoteNumber) / getSampleRate() * juce::MathConstants<double>::twoPi;
+            currentAngle = 0.0;
+            adsr.noteOn();
+        }
+
+        void stopNote (float, bool) override { adsr.noteOff(); }
+        void pitchWheelMoved (int) override {}
+        void controllerMoved (int, int) override {}
+
+        void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
+        {
+            for (int sample = 0; sample < numSamples; ++sample)
+            {
+                auto envelopeValue = adsr.getNextSample();
+                float rawSample = 0.0f;
+
+                switch (oscType)
+                {
+                    case 0: rawSample = (float) std::sin (currentAngle); break;
+                    case 1: rawSample = (float) ((currentAngle / juce::MathConstants<double>::pi) - 1.0); break;
+                    case 2: rawSample = currentAngle < juce::MathConstants<double>::pi ? 1.0f : -1.0f; break;
+                    case 3: rawSample = (float) (2.0 * std::abs (2.0 * (currentAngle / juce::MathConstants<double>::twoPi) - 1.0) - 1.0); break;
+                    default: break;
+                }
+
+                auto sampleValue = filter.processSample (0, rawSample * level * envelopeValue);
+                for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+                    outputBuffer.addSample (channel, startSample + sample, sampleValue);
+
+                currentAngle += angleDelta;
+                if (currentAngle >= juce::MathConstants<double>::twoPi)
+                    currentAngle -= juce::MathConstants<double>::twoPi;
+            }
+        }
+
+        void prepare (double sampleRate)
+        {
+            adsr.setSampleRate (sampleRate);
+            adsr.setParameters ({ 0.05f, 0.1f, 0.8f, 0.5f });
+            filter.prepare ({ sampleRate, 512, 2 });
+            filter.setType (juce::dsp::StateVariableTPTFilterType::lowpass);
+        }
+
+        void updateParameters (int type, float cutoff, float resonance)
+        {
+            oscType = type;
+            filter.setCutoffFrequency (cutoff);
+            filter.setResonance (resonance);
+        }
+
+    private:
+        juce::ADSR adsr;
+        juce::dsp::StateVariableTPTFilter<float> filter;
+        double currentAngle = 0.0, angleDelta = 0.0;
+        float level = 0.0f;
+        int oscType = 1;
+    };
+
+    // Linear ADSR with the same segment behaviour as juce::ADSR, rendered a whole segment at a time.
+    // Each segment is a straight ramp, so a block costs a few vectorised fills rather than
+    // one state-machine step per sample.
+    class BlockADSR
+    {
+    public:
+        void setSampleRate (double newSampleRate) { sampleRate = newSampleRate; recalculateRates(); }
+        void setParameters (const juce::ADSR::Parameters& newParams) { params = newParams; recalculateRates(); }
+
+        void noteOn()
+        {
+            if (attackRate > 0.0f)      state = State::attack;
+            else if (decayRate > 0.0f)  { value = 1.0f; state = State::decay; }
+            else                        { value = params.sustain; state = State::sustain; }
+        }
+
+        void noteOff()
+        {
+            if (state == State::idle) return;
+
+            if (params.release > 0.0f && value > 0.0f) {
+                releaseRate = (float) (value / (params.release * sampleRate));
+                state = State::release;
+            } else {
+                reset();
+            }
+        }
+
+        void reset() { value = 0.0f; state = State::idle; }
+        bool isActive() const { return state != State::idle; }
+
+        // Writes the next numSamples envelope values
+        void render (float* out, int numSamples)
+        {
+            int i = 0;
+            while (i < numSamples)
+            {
+                switch (state)
+                {
+                    case State::idle:
+                        juce::FloatVectorOperations::clear (out + i, numSamples - i);
+                        return;
+
+                    case State::sustain:
+                        value = params.sustain;
+                        juce::FloatVectorOperations::fill (out + i, value, numSamples - i);
+                        return;
+
+                    case State::attack:
+                        i += ramp (out + i, numSamples - i, attackRate, 1.0f);
+                        if (value >= 1.0f) state = decayRate > 0.0f ? State::decay : State::sustain;
+                        break;
+
+                    case State::decay:
+                        i += ramp (out + i, numSamples - i, -decayRate, params.sustain);
+                        if (value <= params.sustain) state = State::sustain;
+                        break;
+
+                    case State::release:
+                        i += ramp (out + i, numSamples - i, -releaseRate, 0.0f);
+                        if (value <= 0.0f) reset();
+                        break;
+                }
+            }
+        }
+
+    private:
+        enum class State { idle, attack, decay, sustain, release };
+
+        // Fills a straight line towards target, stopping on the sample that reaches it. Returns samples written.
+        int ramp (float* out, int maxSamples, float rate, float target)
+        {
+            const int toTarget = juce::jmax (1, (int) std::ceil ((target - value) / rate));
+            const int count = juce::jmin (toTarget, maxSamples);
+            const float start = value;
+
+            for (int i = 0; i < count; ++i)
+                out[i] = start + (float) (i + 1) * rate;
+
+            if (count == toTarget) {
+                out[count - 1] = target;
+                value = target;
+            } else {
+                value = start + (float) count * rate;
+            }
+            return count;
+        }
+
+        void recalculateRates()
+        {
+            auto rateFor = [this] (float distance, float seconds) {
+                return seconds > 0.0f ? (float) (distance / (seconds * sampleRate)) : -1.0f;
+            };
+            attackRate = rateFor (1.0f, params.attack);
+            decayRate = rateFor (1.0f - params.sustain, params.decay);
+        }
+
+        juce::ADSR::Parameters params;
+        double sampleRate = 44100.0;
+        float value = 0.0f, attackRate = 0.0f, decayRate = 0.0f, releaseRate = 0.0f;
+        State state = State::idle;
+    };
+
+    // One juce::SynthesiserVoice per note, rendered in chunks with the same oscillator and filter as
+    // the VoiceBank: the per-voice design the bank replaced, kept to measure it against
+    class SynthVoice : public juce::SynthesiserVoice
+    {
+    public:
+        SynthVoice() {}
+
+        bool canPlaySound (juce::SynthesiserSound* sound) override { return dynamic_cast<juce::SynthesiserSound*> (sound) != nullptr; }
+
+        void startNote (int midiNoteNumber, float velocity, juce::SynthesiserSound*, int) override
+        {
+            level = velocity * 0.25f;
+            phaseIncrement = (float) (juce::MidiMessage::getMidiNoteInHertz (midiNoteNumber) / getSampleRate());
+            phase = 0.0f;
+            mipLevel = Wavetable::getLevelFor (phaseIncrement);
+            adsr.noteOn();
+        }
+
+        void stopNote (float, bool allowTailOff) override
+        {
+            adsr.noteOff();
+            if (!allowTailOff) {
+                adsr.reset();
+                clearCurrentNote();
+            }
+        }
+
+        void pitchWheelMoved (int) override {}
+        void controllerMoved (int, int) override {}
+
+        // Renders mono in chunks (oscillator, envelope, gain, filter as separate passes), then adds it to every channel
+        void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
+        {
+            if (!adsr.isActive()) {
+                clearCurrentNote();
+                return;
+            }
+
+            while (numSamples > 0)
+            {
+                const int n = juce::jmin (numSamples, chunkSize);
+
+                phase = Oscillator::render (table->getLevel (mipLevel), mono, 1, n, phase, phaseIncrement);
+
+                adsr.render (envelope, n);
+                juce::FloatVectorOperations::multiply (envelope, level, n);
+                juce::FloatVectorOperations::multiply (mono, envelope, n);
+
+                filter.process (mono, n);
+
+                for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
+                    juce::FloatVectorOperations::add (outputBuffer.getWritePointer (channel, startSample), mono, n);
+
+                startSample += n;
+                numSamples -= n;
+
+                if (!adsr.isActive()) {
+                    clearCurrentNote();
+                    break;
+                }
+            }
+        }
+
+        void prepare (double sampleRate)
+        {
+            adsr.setSampleRate (sampleRate);
+            juce::ADSR::Parameters adsrParams;
+            adsrParams.attack = 0.05f;
+            adsrParams.decay = 0.1f;
+            adsrParams.sustain = 0.8f;
+            adsrParams.release = 0.5f;
+            adsr.setParameters (adsrParams);
+
+            filter.setSampleRate (sampleRate);
+            filter.reset();
+        }
+
+        void updateParameters (int type, float cutoff, float resonance)
+        {
+            table = &Wavetable::getBuiltin ((Waveform) juce::jlimit (0, 3, type));
+            filter.setParameters (juce::jlimit (20.0f, 20000.0f, cutoff), juce::jlimit (0.1f, 20.0f, resonance));
+        }
+
+    private:
+        static constexpr int chunkSize = 128; // A whole number of SIMD registers on every target
+
+        BlockADSR adsr;
+        SvfLowpass filter;
+        float phase = 0.0f, phaseIncrement = 0.0f; // In cycles
+        float level = 0.0f;
+        const Wavetable* table = &Wavetable::getBuiltin (Waveform::saw); // Default Saw
+        int mipLevel = 0;
+
+        alignas (64) float mono[chunkSize];
+        alignas (64) float envelope[chunkSize];
+    };
+
+    // All metrics are costs (time per unit of work), so lower is better
+    class BenchReport
+    {
+    public:
+        void add (const juce::String& name, double value, const juce::String& unit)
+        {
+            metrics.push_back ({ name, value, unit });
+        }
+
+        bool writeJson (const juce::File& file) const
+        {
+            juce::DynamicObject::Ptr values = new juce::DynamicObject();
+            for (const auto& m : metrics)
+            {
+                juce::DynamicObject::Ptr entry = new juce::DynamicObject();
+                entry->setProperty ("value", m.value);
+                entry->setProperty ("unit", m.unit);
+                values->setProperty (m.name, juce::var (entry.get()));
+            }
+
+            juce::DynamicObject::Ptr root = new juce::DynamicObject();
+            root->setProperty ("format", 1);
+            root->setProperty ("time", juce::Time::getCurrentTime().toISO8601 (true));
+            root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+            root->setProperty ("cores", juce::SystemStats::getNumCpus());
+            root->setProperty ("metrics", juce::var (values.get()));
+            return file.replaceWithText (juce::JSON::toString (juce::var (root.get())));
+        }
+
+        // Prints every metric next to its baseline value. Returns the number that got slower by more than tolerance.
+        int compareWith (const juce::File& baselineFile, double tolerance) const
+        {
+            const auto baseline = juce::JSON::parse (baselineFile)["metrics"];
+            if (! baseline.isObject())
+            {
+                std::cerr << "Not a benchmark result: " << baselineFile.getFullPathName() << "\n";
+                return -1;
+            }
+
+            std::printf ("Baseline compare (tolerance %.0f%%)\n%-32s  %12s  %12s  %8s\n", tolerance * 100.0, "metric", "baseline", "current", "change");
+
+            int numRegressions = 0;
+            for (const auto& m : metrics)
+            {
+                const auto entry = baseline.getProperty (m.name, {});
+                if (! entry.isObject())
+                {
+                    std::printf ("%-32s  %12s  %12.3f  %8s  new\n", m.name.toRawUTF8(), "-", m.value, "-");
+                    continue;
+                }
+
+                const double before = entry["value"];
+                const double change = before > 0.0 ? m.value / before - 1.0 : 0.0;
+                const bool regressed = change > tolerance;
+                numRegressions += regressed ? 1 : 0;
+
+                std::printf ("%-32s  %12.3f  %12.3f  %+7.1f%%  %s\n", m.name.toRawUTF8(), before, m.value, change * 100.0,
+                             regressed ? "REGRESSION" : "");
+            }
+
+            std::cout << numRegressions << " regression(s)\n\n";
+            return numRegressions;
+        }
+
+    private:
+        struct Metric
+        {
+            juce::String name;
+            double value;
+            juce::String unit;
+        };
+
+        std::vector<Metric> metrics;
+    };
+
+    BenchReport report;
+    int numRepeats = 5;
+
+    // Median of numRepeats runs of a measurement, so one disturbed run does not move the result
+    template <typename Fn>
+    double medianOf (Fn&& measure)
+    {
+        std::vector<double> runs;
+        for (int i = 0; i < numRepeats; ++i)
+            runs.push_back (measure());
+
+        std::nth_element (runs.begin(), runs.begin() + (std::ptrdiff_t) runs.size() / 2, runs.end());
+        return runs[runs.size() / 2];
+    }
+
+    // Seconds per block for one sustained voice
+    template <typename VoiceType>
+    double timeVoice (int oscType, int blockSize, int numBlocks)
+    {
+        const double sampleRate = 48000.0;
+        VoiceType voice;
+        voice.setCurrentPlaybackSampleRate (sampleRate);
+        voice.prepare (sampleRate);
+        voice.updateParameters (oscType, 2000.0f, 1.0f);
+        voice.startNote (57, 0.8f, nullptr, 0);
+
+        juce::AudioBuffer<float> output (2, blockSize);
+        for (int i = 0; i < 100; ++i) // Past the attack and decay, into sustain
+            voice.renderNextBlock (output, 0, blockSize);
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+            voice.renderNextBlock (output, 0, blockSize);
+        return secondsSince (start) / numBlocks;
+    }
+
+    // SynthVoice's block kernel against the old per-sample loop, per oscillator type and block size
+    void benchVoiceKernel (int numSamples)
+    {
+        const char* names[] = { "sine", "saw", "square", "triangle" };
+
+        std::cout << "Voice kernel: one voice, stereo\n"
+                  << "osc       block  reference ns/sample  kernel ns/sample  speedup\n";
+
+        for (int blockSize : { 32, 128, 512 })
+        {
+            const int numBlocks = juce::jmax (1, numSamples / blockSize);
+            for (int oscType = 0; oscType < 4; ++oscType)
+            {
+                const double reference = medianOf ([&] { return timeVoice<ReferenceVoice> (oscType, blockSize, numBlocks); }) / blockSize;
+                const double kernel = medianOf ([&] { return timeVoice<SynthVoice> (oscType, blockSize, numBlocks); }) / blockSize;
+                std::printf ("%-8s  %5d  %19.2f  %16.2f  %6.2fx\n", names[oscType], blockSize, reference * 1.0e9, kernel * 1.0e9, reference / kernel);
+                report.add ("voice.kernel." + juce::String (names[oscType]) + ".b" + juce::String (blockSize), kernel * 1.0e9, "ns/sample");
+            }
+        }
+        std::cout << "\n";
+    }
+
+    // One VoiceBank holding chords of growing size, against the same number of separate SynthVoices
+    void benchVoiceBank (int blockSize, int numBlocks)
+    {
+        const double sampleRate = 48000.0;
+        juce::AudioBuffer<float> output (2, blockSize);
+
+        std::cout << "Voice bank: sustained chord, stereo, block " << blockSize << "\n"
+                  << "voices  separate us/block  bank us/block  speedup  bank cost vs 1 voice\n";
+
+        double bankSingleVoice = 0.0;
+        for (int numVoices : { 1, 4, 8, 16, 32, 64 })
+        {
+            VoiceBank bank;
+            bank.prepare (sampleRate);
+            bank.setWaveform (Waveform::saw);
+            bank.setFilter (2000.0f, 1.0f);
+
+            juce::OwnedArray<SynthVoice> separate;
+            for (int v = 0; v < numVoices; ++v)
+            {
+                bank.noteOn (36 + v, 0.8f);
+
+                auto* voice = separate.add (new SynthVoice());
+                voice->setCurrentPlaybackSampleRate (sampleRate);
+                voice->prepare (sampleRate);
+                voice->updateParameters (1, 2000.0f, 1.0f);
+                voice->startNote (36 + v, 0.8f, nullptr, 0);
+            }
+
+            for (int i = 0; i < 100; ++i) // Into sustain
+            {
+                bank.render (output, 0, blockSize);
+                for (auto* voice : separate)
+                    voice->renderNextBlock (output, 0, blockSize);
+            }
+
+            const double separateTime = medianOf ([&] {
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (int i = 0; i < numBlocks; ++i)
+                    for (auto* voice : separate)
+                        voice->renderNextBlock (output, 0, blockSize);
+                return secondsSince (start) / numBlocks;
+            });
+
+            const double bankTime = medianOf ([&] {
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (int i = 0; i < numBlocks; ++i)
+                    bank.render (output, 0, blockSize);
+                return secondsSince (start) / numBlocks;
+            });
+
+            if (numVoices == 1) bankSingleVoice = bankTime;
+
+            std::printf ("%6d  %17.2f  %13.2f  %6.2fx  %19.2fx\n", numVoices, separateTime * 1.0e6, bankTime * 1.0e6,
+                         separateTime / bankTime, bankTime / bankSingleVoice);
+
+            const auto suffix = ".v" + juce::String (numVoices) + ".b" + juce::String (blockSize);
+            report.add ("voice.separate" + suffix, separateTime * 1.0e6, "us/block");
+            report.add ("voice.bank" + suffix, bankTime * 1.0e6, "us/block");
+        }
+        std::cout << "\n";
+    }
+
+    // VoicePool::allocate for 64 tracks of 8 held voices, each starting 2 notes a block: with room
+    // to spare, and with a budget that makes every note-on steal
+    void benchVoicePool (int numBlocks)
+    {
+        constexpr int numBanks = 64;
+        std::cout << "Voice pool: " << numBanks << " tracks x 8 voices, 2 note-ons per track and block\n"
+                  << "budget  us/block  steals/block\n";
+
+        for (int budget : { VoicePool::maxBudget, numBanks * 8 })
+        {
+            std::vector<std::unique_ptr<VoiceBank>> banks;
+            std::vector<juce::MidiBuffer> midi ((size_t) numBanks);
+            for (int b = 0; b < numBanks; ++b)
+            {
+                banks.push_back (std::make_unique<VoiceBank>());
+                banks.back()->prepare (48000.0);
+                midi[(size_t) b].addEvent (juce::MidiMessage::noteOn (1, 40, 0.8f), 0);
+                midi[(size_t) b].addEvent (juce::MidiMessage::noteOn (1, 41, 0.8f), 0);
+            }
+
+            VoicePool pool;
+            pool.setBudget (budget);
+            pool.prepare (48000.0, 512, 0);
+
+            // Only allocate() is timed; the banks are refilled in between, so every block starts full
+            const double perBlock = medianOf ([&] {
+                juce::int64 ticks = 0;
+                for (int i = 0; i < numBlocks; ++i)
+                {
+                    for (auto& bank : banks)
+                    {
+                        bank->setVoiceGrant (nullptr, 0, 0);
+                        bank->allNotesOff (false);
+                        for (int k = 0; k < 8; ++k)
+                            bank->noteOn (48 + k * 3, 0.8f);
+                    }
+
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    pool.allocate (numBanks, [&] (int b) { return VoicePool::Client { banks[(size_t) b].get(), &midi[(size_t) b], b % 2 }; });
+                    ticks += juce::Time::getHighResolutionTicks() - start;
+                }
+                return juce::Time::highResolutionTicksToSeconds (ticks) / numBlocks;
+            });
+
+            const double stealsPerBlock = (double) pool.getCounters().stolen / ((double) numBlocks * numRepeats);
+            std::printf ("%6d  %8.2f  %12.1f\n", budget, perBlock * 1.0e6, stealsPerBlock);
+            report.add ("voice.pool." + juce::String (budget == VoicePool::maxBudget ? "free" : "steal"), perBlock * 1.0e6, "us/block");
+        }
+        std::cout << "\n";
+    }
+
+    // SamplerProcessor with N held notes, pitched around the root. The sample fits in its head, so
+    // this times the gather and interpolation, not the disk; notes are cut and restarted before they end.
+    void benchSampler (int blockSize, int numBlocks)
+    {
+        std::cout << "Sampler: in-memory sample, pitched notes, block " << blockSize << "\n"
+                  << "voices  us/block  ns/voice-sample\n";
+
+        const auto file = juce::File::createTempFile (".wav");
+        {
+            juce::AudioBuffer<float> source (2, Sample::headFrames);
+            juce::Random random (3);
+            for (int channel = 0; channel < 2; ++channel)
+                for (int i = 0; i < source.getNumSamples(); ++i)
+                    source.setSample (channel, i, random.nextFloat() * 2.0f - 1.0f);
+
+            juce::WavAudioFormat wav;
+            std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (file.createOutputStream().release(), 48000.0, 2, 24, {}, 0));
+            if (writer == nullptr) return;
+            writer->writeFromAudioSampleBuffer (source, 0, source.getNumSamples());
+        }
+
+        SamplePool pool;
+        for (int numVoices : { 1, 8, 32 })
+        {
+            SamplerProcessor sampler (pool);
+            sampler.addZone ({ pool.get (file), 60, 0, 127, 1, 127, 1.0f });
+            sampler.prepareToPlay (48000.0, blockSize);
+
+            juce::MidiBuffer chord, noMidi;
+            for (int v = 0; v < numVoices; ++v)
+                chord.addEvent (juce::MidiMessage::noteOn (1, 53 + v % 14, 0.8f), 0); // Up to seven semitones either way
+
+            juce::AudioBuffer<float> output (2, blockSize);
+            const int restartInterval = Sample::headFrames * 2 / 3 / blockSize;
+            const double perBlock = medianOf ([&] {
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (int i = 0; i < numBlocks; ++i)
+                {
+                    if (i % restartInterval == 0) sampler.allNotesOff();
+                    sampler.processBlock (output, i % restartInterval == 0 ? chord : noMidi);
+                }
+                return secondsSince (start) / numBlocks;
+            });
+
+            std::printf ("%6d  %8.2f  %15.2f\n", numVoices, perBlock * 1.0e6, perBlock * 1.0e9 / ((double) numVoices * blockSize));
+            report.add ("voice.sampler." + juce::String (numVoices), perBlock * 1.0e6, "us/block");
+        }
+        file.deleteFile();
+        std::cout << "\n";
+    }
+
+    // Simulated audio callbacks at 400 Hz (120 samples at 48 kHz) that log an event every buffer,
+    // against the same callbacks without logging
+    void benchLoggerStress (int seconds)
+    {
+        const double sampleRate = 48000.0;
+        const int blockSize = 120;
+        const int numCallbacks = (int) (seconds * sampleRate / blockSize);
+        const auto ticksPerBlock = juce::Time::secondsToHighResolutionTicks (blockSize / sampleRate);
+
+        Mixer mixer;
+        addSynthTracks (mixer, 8);
+        mixer.setNumRenderThreads (0);
+        mixer.prepareToPlay (sampleRate, blockSize);
+        holdChords (mixer);
+
+        juce::AudioBuffer<float> output (2, blockSize);
+        juce::MidiBuffer noMidi;
+
+        std::cout << "Logger stress: 8 tracks, " << blockSize << " samples at 400 Hz for " << seconds << " s per run\n"
+                  << "logging  callback mean us  callback max us  log mean ns  log max ns\n";
+
+        for (bool logging : { false, true })
+        {
+            const int droppedBefore = RealTimeLogger::getNumDroppedEvents();
+            double callbackTotal = 0.0, callbackMax = 0.0, logTotal = 0.0, logMax = 0.0, lastCallback = 0.0;
+            auto deadline = juce::Time::getHighResolutionTicks();
+
+            for (int i = 0; i < numCallbacks; ++i)
+            {
+                const auto start = juce::Time::getHighResolutionTicks();
+                mixer.processBlock (output, noMidi);
+
+                if (logging)
+                {
+                    const auto logStart = juce::Time::getHighResolutionTicks();
+                    RealTimeLogger::event ("Stress block %.0f: previous callback %.1f us", i, lastCallback * 1.0e6);
+                    const double logTime = secondsSince (logStart);
+                    logTotal += logTime;
+                    logMax = juce::jmax (logMax, logTime);
+                }
+
+                lastCallback = secondsSince (start);
+                callbackTotal += lastCallback;
+                callbackMax = juce::jmax (callbackMax, lastCallback);
+
+                deadline += ticksPerBlock; // Hold the real callback rate so the writer thread runs alongside
+                while (juce::Time::getHighResolutionTicks() < deadline)
+                    std::this_thread::yield();
+            }
+
+            std::printf ("%7s  %16.2f  %15.2f  %11.0f  %10.0f\n", logging ? "on" : "off", callbackTotal / numCallbacks * 1.0e6,
+                         callbackMax * 1.0e6, logTotal / numCallbacks * 1.0e9, logMax * 1.0e9);
+
+            if (logging)
+            {
+                std::cout << "dropped events: " << RealTimeLogger::getNumDroppedEvents() - droppedBefore << "\n";
+                report.add ("logger.stress.callback", callbackTotal / numCallbacks * 1.0e6, "us/callback");
+            }
+        }
+        std::cout << "\n";
+        mixer.releaseResources();
+    }
+
+    // Cost of one call on the calling thread; formatting and file I/O happen later on the writer thread
+    void benchLoggerCalls()
+    {
+        const int numCalls = 2000; // Below the event ring's capacity, so nothing is dropped
+
+        const double event = medianOf ([&] {
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < numCalls; ++i)
+                RealTimeLogger::event ("Bench event %.0f", i);
+            const double perCall = secondsSince (start) / numCalls;
+            juce::Thread::sleep (100); // Let the writer drain before the next run
+            return perCall;
+        });
+
+        const double log = medianOf ([&] {
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < numCalls; ++i)
+                RealTimeLogger::log ("Bench message " + juce::String (i));
+            const double perCall = secondsSince (start) / numCalls;
+            juce::Thread::sleep (100);
+            return perCall;
+        });
+
+        std::printf ("Logger calls\nevent() %.0f ns/call, log() %.0f ns/call\n\n", event * 1.0e9, log * 1.0e9);
+        report.add ("logger.event", event * 1.0e9, "ns/call");
+        report.add ("logger.log", log * 1.0e9, "ns/call");
+    }
+
+    // How ProjectModel imported notes before the batch API: a dedup scan and a full sort per note
+    void referenceImport (std::vector<NoteEvent>& trackNotes, const std::vector<NoteEvent>& notes)
+    {
+        trackNotes.clear();
+        for (auto note : notes)
+        {
+            note.note = juce::jlimit (0, 127, note.note);
+            note.velocity = juce::jlimit (0.0f, 1.0f, note.velocity);
+            note.durationBeats = std::max (0.01, note.durationBeats);
+
+            trackNotes.erase (std::remove_if (trackNotes.begin(), trackNotes.end(), [&] (const NoteEvent& e) {
+                return e.note == note.note && std::abs (e.startBeat - note.startBeat) < 0.001;
+            }), trackNotes.end());
+
+            trackNotes.push_back (note);
+            std::sort (trackNotes.begin(), trackNotes.end());
+        }
+    }
+
+    // Random notes on a 16th-note grid, as minified JSON note arrays (the AI bridge format)
+    juce::var makeNotesVar (int numNotes, juce::Random& random)
+    {
+        juce::Array<juce::var> notesArray;
+        for (int i = 0; i < numNotes; ++i)
+            notesArray.add (juce::Array<juce::var> { 36 + random.nextInt (48), 0.8, random.nextInt (numNotes * 2) * 0.25, 0.25 * (1 + random.nextInt (8)) });
+        return notesArray;
+    }
+
+    // Importing a generated track against note count, and a single grid edit into the result
+    void benchImport (int maxNotes)
+    {
+        const int referenceLimit = 20000; // Quadratic; larger imports take minutes
+
+        std::cout << "Note import: one track, random 16th-note grid\n"
+                  << "notes  reference ms  batch ms  speedup  single add us\n";
+
+        juce::Random random (1234);
+        for (int numNotes : { 1000, 5000, 10000, 20000, 50000, 100000 })
+        {
+            if (numNotes > maxNotes) break;
+
+            const auto project = makeNotesVar (numNotes, random);
+
+            double reference = 0.0;
+            if (numNotes <= referenceLimit)
+            {
+                std::vector<NoteEvent> notes, trackNotes;
+                for (const auto& n : *project.getArray())
+                    notes.push_back ({ (int) n[0], (float) n[1], (double) n[2], (double) n[3] });
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                referenceImport (trackNotes, notes);
+                reference = secondsSince (start);
+            }
+
+            const double batch = medianOf ([&] {
+                ProjectModel model;
+                const auto start = juce::Time::getHighResolutionTicks();
+                model.fromMinifiedVar (0, project);
+                return secondsSince (start);
+            });
+
+            // One grid edit into the imported track, including the snapshot publish
+            ProjectModel model;
+            model.fromMinifiedVar (0, project);
+            const int numEdits = 100;
+            int edit = 0;
+            const double singleAdd = medianOf ([&] {
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (int i = 0; i < numEdits; ++i, ++edit)
+                    model.addNote (0, { 60, 0.8f, edit * 0.25 + 0.125, 0.25 });
+                return secondsSince (start) / numEdits;
+            });
+
+            if (reference > 0.0)
+                std::printf ("%5d  %12.1f  %8.2f  %6.0fx  %13.1f\n", numNotes, reference * 1.0e3, batch * 1.0e3, reference / batch, singleAdd * 1.0e6);
+            else
+                std::printf ("%5d  %12s  %8.2f  %7s  %13.1f\n", numNotes, "-", batch * 1.0e3, "-", singleAdd * 1.0e6);
+
+            report.add ("model.import." + juce::String (numNotes), batch * 1.0e3, "ms");
+            report.add ("model.addNote." + juce::String (numNotes), singleAdd * 1.0e6, "us");
+        }
+        std::cout << "\n";
+    }
+
+    // An 8-track project for the JSON and UI benchmarks
+    void fillProject (ProjectModel& model, Mixer& mixer, int notesPerTrack)
+    {
+        juce::Random random (99);
+        for (int t = 0; t < 8; ++t)
+        {
+            mixer.addTrack (std::make_unique<InstrumentTrack> ("Track " + juce::String (t + 1)));
+            model.fromMinifiedVar (t, makeNotesVar (notesPerTrack, random));
+        }
+    }
+
+    // getFullProjectJson / loadFullProjectJson, i.e. ProjectJson plus the JSON text round trip
+    void benchProjectJson()
+    {
+        std::cout << "Project JSON: 8 tracks\n"
+                  << "notes/track  save ms  load ms\n";
+
+        for (int notesPerTrack : { 100, 1000, 10000 })
+        {
+            ProjectModel model;
+            Transport transport;
+            Mixer mixer;
+            fillProject (model, mixer, notesPerTrack);
+
+            juce::String json;
+            const double save = medianOf ([&] {
+                const auto start = juce::Time::getHighResolutionTicks();
+                json = ProjectJson::toJson (model, transport, mixer);
+                return secondsSince (start);
+            });
+
+            const double load = medianOf ([&] {
+                ProjectModel loadedModel;
+                Transport loadedTransport;
+                const auto start = juce::Time::getHighResolutionTicks();
+                ProjectJson::load (juce::JSON::parse (json), loadedModel, loadedTransport, mixer);
+                return secondsSince (start);
+            });
+
+            std::printf ("%11d  %7.2f  %7.2f\n", notesPerTrack, save * 1.0e3, load * 1.0e3);
+            report.add ("project.save." + juce::String (notesPerTrack), save * 1.0e3, "ms");
+            report.add ("project.load." + juce::String (notesPerTrack), load * 1.0e3, "ms");
+        }
+        std::cout << "\n";
+    }
+
+    // The state build in MainComponent::timerCallback: UiStateSync::buildUpdate plus JSON::toString
+    void benchUiSync()
+    {
+        const int notesPerTrack = 5000;
+        const int numTicks = 200;
+
+        ProjectModel model;
+        Transport transport;
+        Mixer mixer;
+        fillProject (model, mixer, notesPerTrack);
+        UiStateSync sync;
+
+        auto buildTick = [&] {
+            auto update = sync.buildUpdate (model, transport, mixer, 0);
+            return update.isObject() ? juce::JSON::toString (update).length() : 0;
+        };
+
+        const double full = medianOf ([&] {
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < numTicks; ++i)
+            {
+                sync.requestFullSync();
+                buildTick();
+            }
+            return secondsSince (start) / numTicks;
+        });
+
+        // A grid edit on the shown track between ticks; only the build is timed
+        int edit = 0;
+        const double delta = medianOf ([&] {
+            double total = 0.0;
+            for (int i = 0; i < numTicks; ++i, ++edit)
+            {
+                model.addNote (0, { 60, 0.8f, edit * 0.25 + 0.125, 0.25 });
+                const auto start = juce::Time::getHighResolutionTicks();
+                buildTick();
+                total += secondsSince (start);
+            }
+            return total / numTicks;
+        });
+
+        const double idle = medianOf ([&] {
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < numTicks; ++i)
+                buildTick();
+            return secondsSince (start) / numTicks;
+        });
+
+        std::printf ("UI state build: 8 tracks x %d notes\nfull %.1f us, one-note delta %.1f us, unchanged %.2f us\n\n",
+                     notesPerTrack, full * 1.0e6, delta * 1.0e6, idle * 1.0e6);
+        report.add ("ui.full", full * 1.0e6, "us/tick");
+        report.add ("ui.delta", delta * 1.0e6, "us/tick");
+        report.add ("ui.idle", idle * 1.0e6, "us/tick");
+    }
+
+    double timeMixer (Mixer& mixer, int blockSize, int numBlocks)
+    {
+        juce::AudioBuffer<float> output (2, blockSize);
+        juce::MidiBuffer noMidi;
+
+        for (int i = 0; i < 50; ++i) // Warm up: caches, voice attack, thread wake-up
+            mixer.processBlock (output, noMidi);
+
+        return medianOf ([&] {
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (int i = 0; i < numBlocks; ++i)
+                mixer.processBlock (output, noMidi);
+            return secondsSince (start) / numBlocks;
+        });
+    }
+
+    // Mixer::processBlock with the default render threads, from 1 to 128 tracks
+    void benchMixerTracks (int blockSize, int numBlocks)
+    {
+        const double blockPeriod = blockSize / 48000.0;
+
+        std::cout << "Mixer tracks: 8 voices per track, block " << blockSize << ", default threads\n"
+                  << "tracks  us/block  dsp load\n";
+
+        for (int numTracks : { 1, 2, 4, 8, 16, 32, 64, 128 })
+        {
+            Mixer mixer;
+            addSynthTracks (mixer, numTracks);
+            mixer.prepareToPlay (48000.0, blockSize);
+            holdChords (mixer);
+
+            const double perBlock = timeMixer (mixer, blockSize, juce::jmax (50, numBlocks * 8 / juce::jmax (8, numTracks)));
+            std::printf ("%6d  %8.1f  %7.1f%%\n", numTracks, perBlock * 1.0e6, 100.0 * perBlock / blockPeriod);
+            report.add ("mixer.tracks." + juce::String (numTracks), perBlock * 1.0e6, "us/block");
+            mixer.releaseResources();
+        }
+        std::cout << "\n";
+    }
+
+    // 64 tracks of which only a few play, as in most sessions: idle tracks are skipped, not rendered
+    void benchMixerIdle (int blockSize, int numBlocks)
+    {
+        constexpr int numTracks = 64;
+        std::cout << "Mixer idle: " << numTracks << " tracks, block " << blockSize << "\n"
+                  << "playing  us/block  idle tracks\n";
+
+        for (int numPlaying : { 0, 4, 16, 64 })
+        {
+            Mixer mixer;
+            addSynthTracks (mixer, numTracks);
+            mixer.prepareToPlay (48000.0, blockSize);
+
+            for (int t = 0; t < numPlaying; ++t)
+                for (int k = 0; k < 8; ++k)
+                    mixer.getTrack (t)->getScheduledMidi().addEvent (juce::MidiMessage::noteOn (1, 48 + k * 3, 0.8f), 0);
+
+            const double perBlock = timeMixer (mixer, blockSize, numBlocks);
+            std::printf ("%7d  %8.1f  %11d\n", numPlaying, perBlock * 1.0e6, mixer.getNumIdleTracks());
+            report.add ("mixer.idle.p" + juce::String (numPlaying), perBlock * 1.0e6, "us/block");
+            mixer.releaseResources();
+        }
+        std::cout << "\n";
+    }
+
+    // MasterLimiter on a stereo signal that keeps it limiting, per sample for several lookaheads.
+    // The cost should not grow with the lookahead.
+    void benchLimiter (int blockSize, int numBlocks)
+    {
+        std::cout << "Master limiter: block " << blockSize << "\n"
+                  << "lookahead  ns/sample\n";
+
+        juce::AudioBuffer<float> source (2, blockSize), buffer (2, blockSize);
+        juce::Random random (7);
+        for (int channel = 0; channel < 2; ++channel)
+            for (int i = 0; i < blockSize; ++i)
+                source.setSample (channel, i, (random.nextFloat() * 2.0f - 1.0f) * (i % 64 == 0 ? 4.0f : 1.5f));
+
+        for (double lookaheadMs : { 0.0, 1.0, 5.0, 20.0 })
+        {
+            MasterLimiter limiter;
+            limiter.setLookahead (lookaheadMs);
+            limiter.prepare (48000.0, 2);
+
+            const double perSample = medianOf ([&] {
+                juce::int64 ticks = 0;
+                for (int b = 0; b < numBlocks; ++b)
+                {
+                    buffer.makeCopyOf (source, true);
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    limiter.process (buffer, blockSize);
+                    ticks += juce::Time::getHighResolutionTicks() - start;
+                }
+                return juce::Time::highResolutionTicksToSeconds (ticks) / ((double) numBlocks * blockSize);
+            });
+
+            std::printf ("%6.0f ms  %9.2f\n", lookaheadMs, perSample * 1.0e9);
+            report.add ("mixer.limiter.la" + juce::String ((int) lookaheadMs), perSample * 1.0e9, "ns/sample");
+        }
+        std::cout << "\n";
+    }
+
+    // Cost of the compiled routing: every track straight to the master, then through group
+    // buses with two post-fader FX sends each
+    void benchMixerRouting (int blockSize, int numBlocks)
+    {
+        constexpr int numTracks = 32, numGroups = 4;
+        std::cout << "Mixer routing: " << numTracks << " tracks x 8 voices, block " << blockSize << "\n"
+                  << "routing   us/block\n";
+
+        for (const bool routed : { false, true })
+        {
+            Mixer mixer;
+            mixer.setNumRenderThreads (0);
+            addSynthTracks (mixer, numTracks);
+
+            if (routed)
+            {
+                const int reverb = mixer.addBus ("Reverb", Bus::Kind::fxReturn);
+                const int delay = mixer.addBus ("Delay", Bus::Kind::fxReturn);
+                for (int g = 0; g < numGroups; ++g)
+                    mixer.addBus ("Group " + juce::String (g + 1), Bus::Kind::group);
+
+                for (int t = 0; t < numTracks; ++t)
+                {
+                    auto& track = *mixer.getTrack (t);
+                    mixer.setOutput (track, 2 + t % numGroups);
+                    mixer.setSend (track, reverb, 0.3f, false);
+                    mixer.setSend (track, delay, 0.2f, false);
+                }
+            }
+
+            mixer.prepareToPlay (48000.0, blockSize);
+            holdChords (mixer);
+
+            const double perBlock = timeMixer (mixer, blockSize, numBlocks);
+            const char* name = routed ? "grouped" : "flat";
+            std::printf ("%-8s  %8.1f\n", name, perBlock * 1.0e6);
+            report.add (juce::String ("mixer.routing.") + name, perBlock * 1.0e6, "us/block");
+            mixer.releaseResources();
+        }
+        std::cout << "\n";
+    }
+
+    // Mixer::processBlock with 1..N threads over the same session
+    void benchMixerScaling (int numTracks, int blockSize, int numBlocks)
+    {
+        const double sampleRate = 48000.0;
+        const double blockPeriod = blockSize / sampleRate;
+        const int maxThreads = juce::SystemStats::getNumCpus();
+        double singleThreaded = 0.0;
+
+        std::cout << "Mixer scaling: " << numTracks << " tracks x 8 voices, block " << blockSize << "\n"
+                  << "threads  us/block  speedup  dsp load\n";
+
+        for (int threads = 1; threads <= maxThreads; ++threads)
+        {
+            Mixer mixer;
+            addSynthTracks (mixer, numTracks);
+            mixer.setNumRenderThreads (threads - 1);
+            mixer.prepareToPlay (sampleRate, blockSize);
+            holdChords (mixer);
+
+            const double perBlock = timeMixer (mixer, blockSize, numBlocks);
+            if (threads == 1) singleThreaded = perBlock;
+
+            std::printf ("%7d  %8.1f  %6.2fx  %7.1f%%\n", threads, perBlock * 1.0e6, singleThreaded / perBlock, 100.0 * perBlock / blockPeriod);
+            report.add ("mixer.threads." + juce::String (threads), perBlock * 1.0e6, "us/block");
+            mixer.releaseResources();
+        }
+        std::cout << "\n";
+    }
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: MusicMakerBench [options]\n"
+                 "  --only=<groups>         Comma-separated: voice, mixer, model, project, ui, logger (default: all)\n"
+                 "  --repeats=<n>           Runs per measurement, the median is reported (default 5)\n"
+                 "  --json=<file>           Write every metric to a JSON file\n"
+                 "  --baseline=<file>       Compare against a saved --json run, exit code 1 on regressions\n"
+                 "  --tolerance=<percent>   Slowdown allowed before a metric counts as regressed (default 10)\n"
+                 "  --block=<samples>       Block size for the voice bank and mixer (default 128)\n"
+                 "  --blocks=<n>            Blocks per measurement (default 2000)\n"
+                 "  --tracks=<n>            Tracks for the thread scaling run (default 32)\n"
+                 "  --import-notes=<n>      Largest note import (default 50000)\n"
+                 "  --stress-seconds=<n>    Length of each logger stress run (default 5)\n";
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    auto intOption = [&] (const char* option, int fallback) {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value.getIntValue() : fallback;
+    };
+
+    const int blockSize = juce::jlimit (16, 8192, intOption ("--block", 128));
+    const int numBlocks = juce::jmax (1, intOption ("--blocks", 2000));
+    numRepeats = juce::jmax (1, intOption ("--repeats", 5));
+
+    const auto only = juce::StringArray::fromTokens (args.getValueForOption ("--only"), ",", "");
+    auto runs = [&] (const char* group) { return only.isEmpty() || only.contains (group); };
+
+    if (runs ("voice"))
+    {
+        benchVoiceKernel (blockSize * numBlocks * 10);
+        benchVoiceBank (blockSize, numBlocks);
+        benchVoicePool (numBlocks);
+        benchSampler (blockSize, numBlocks);
+    }
+    if (runs ("model"))   benchImport (juce::jmax (1000, intOption ("--import-notes", 50000)));
+    if (runs ("project")) benchProjectJson();
+    if (runs ("ui"))      benchUiSync();
+    if (runs ("logger"))
+    {
+        benchLoggerCalls();
+        benchLoggerStress (juce::jmax (1, intOption ("--stress-seconds", 5)));
+    }
+    if (runs ("mixer"))
+    {
+        benchMixerTracks (blockSize, numBlocks);
+        benchMixerIdle (blockSize, numBlocks);
+        benchMixerRouting (blockSize, numBlocks);
+        benchLimiter (blockSize, numBlocks);
+        benchMixerScaling (juce::jmax (1, intOption ("--tracks", 32)), blockSize, numBlocks);
+    }
+
+    auto fileOption = [&] (const char* option) { return juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption (option)); };
+
+    if (args.containsOption ("--json"))
+    {
+        if (! report.writeJson (fileOption ("--json")))
+        {
+            std::cerr << "Failed to write " << fileOption ("--json").getFullPathName() << "\n";
+            return 1;
+        }
+    }
+
+    if (args.containsOption ("--baseline"))
+    {
+        const auto tolerance = args.containsOption ("--tolerance") ? args.getValueForOption ("--tolerance").getDoubleValue() : 10.0;
+        const int numRegressions = report.compareWith (fileOption ("--baseline"), juce::jmax (0.0, tolerance) / 100.0);
+        return numRegressions != 0 ? 1 : 0;
+    }
+
+    return 0;
+}
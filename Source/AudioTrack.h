@@ -0,0 +1,75 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Track.h"
+#include "DiskRecorder.h"
+#include <memory>
+#include <utility>
+
+// A track that records from the audio inputs. While a take runs, the audio thread copies the
+// track's input channels into it before the mixer runs; the DiskRecorder writes it out.
+// Recorded audio is not played back yet, so the track renders silence and is always idle.
+class AudioTrack : public Track
+{
+public:
+    AudioTrack (const juce::String& name) : Track (name, TrackType::Audio) {}
+
+    // The Mixer frees a track only once no block can still reach it, so the take is done with
+    ~AudioTrack() override
+    {
+        if (takeOwner != nullptr)
+            takeOwner->release();
+    }
+
+    // Message Thread: armed tracks record whenever the transport does
+    void setArmed (bool shouldArm) { armed.store (shouldArm); touch(); }
+    bool getIsArmed() const { return armed.load(); }
+
+    // Message Thread: the first of one or two input channels; applies from the next take
+    void setInput (int firstChannel, int numChannels)
+    {
+        firstInput = juce::jmax (0, firstChannel);
+        numInputs = juce::jlimit (1, RecordTake::maxChannels, numChannels);
+        touch();
+    }
+    int getFirstInput() const { return firstInput; }
+    int getNumInputs() const { return numInputs; }
+
+    // Message Thread: starts a take, or stops the running one with nullptr. The old take is
+    // released, so its file is closed, only once the audio thread cannot be writing to it.
+    void setRecordTake (std::shared_ptr<RecordTake> take)
+    {
+        recordTake.store (take.get());
+
+        if (auto old = std::exchange (takeOwner, std::move (take)))
+        {
+            if (reclaimer != nullptr) reclaimer->retire (new TakeRelease { std::move (old) });
+            else                      old->release();
+        }
+        touch();
+    }
+    bool isRecording() const { return takeOwner != nullptr; }
+
+    RecordTake* getRecordTake() override { return recordTake.load(); }
+
+    void prepareToPlay (double sampleRate, int) override { prepareFader (sampleRate); }
+    void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer&) override { buffer.clear(); }
+    void releaseResources() override {}
+    void allNotesOff() override {}
+    bool isIdle() override { return true; }
+
+private:
+    // Retired in place of the take: freed after the grace period, which is when the take may close
+    struct TakeRelease
+    {
+        ~TakeRelease() { take->release(); }
+        std::shared_ptr<RecordTake> take;
+    };
+
+    std::atomic<bool> armed { false };
+    std::atomic<RecordTake*> recordTake { nullptr };
+
+    // Message Thread
+    std::shared_ptr<RecordTake> takeOwner;
+    int firstInput = 0, numInputs = 2;
+};
@@ -0,0 +1,425 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// Times every audio callback against its buffer period, and every track's render inside it.
+// Recording is a couple of high resolution tick reads and relaxed atomic adds into fixed
+// histograms, so the audio thread and the render workers never allocate, lock or wait.
+// The message thread collects windows: each collect() folds in what was recorded since the
+// previous one, which the UI shows, and adds it to the session totals that writeReport() dumps.
+//
+// Late callbacks: one that starts more than half a period after the previous one should have
+// finished means the device ran dry (an xrun we caused or the driver did).
+// Overruns: a callback that took longer than its own period.
+//
+// Track histograms are keyed by index, one per track of the mixer's layout. When the layout
+// changes (a track removed, so later ones move down) the message thread publishes a fresh set and
+// track history starts again; when tracks are only added it publishes a bigger set that carries
+// the history over. A set the audio thread may still be recording into is kept until a later
+// callback has started with the new one.
+class CallbackProfiler
+{
+public:
+    struct Stats
+    {
+        uint64_t count = 0;
+        double minMicros = 0.0, avgMicros = 0.0, p99Micros = 0.0, maxMicros = 0.0;
+    };
+
+    // Durations in nanoseconds, four log-spaced buckets per octave (each within 19% of its value)
+    class Histogram
+    {
+    public:
+        static constexpr int numBuckets = 32 * 4;
+
+        // Any thread
+        void record (uint32_t nanos)
+        {
+            buckets[(size_t) bucketFor (nanos)].fetch_add (1, std::memory_order_relaxed);
+            totalNanos.fetch_add (nanos, std::memory_order_relaxed);
+
+            auto lo = minNanos.load (std::memory_order_relaxed);
+            while (nanos < lo && ! minNanos.compare_exchange_weak (lo, nanos, std::memory_order_relaxed)) {}
+            auto hi = maxNanos.load (std::memory_order_relaxed);
+            while (nanos > hi && ! maxNanos.compare_exchange_weak (hi, nanos, std::memory_order_relaxed)) {}
+        }
+
+        // Message Thread: folds the recordings since the last call into the window and the session
+        void collect()
+        {
+            for (size_t i = 0; i < buckets.size(); ++i)
+            {
+                const auto total = buckets[i].load (std::memory_order_relaxed);
+                window.counts[i] = total - seenCounts[i];
+                seenCounts[i] = total;
+                session.counts[i] += window.counts[i];
+            }
+
+            const auto total = totalNanos.load (std::memory_order_relaxed);
+            window.totalNanos = total - seenTotalNanos;
+            seenTotalNanos = total;
+            session.totalNanos += window.totalNanos;
+
+            window.minNanos = minNanos.exchange (std::numeric_limits<uint32_t>::max(), std::memory_order_relaxed);
+            window.maxNanos = maxNanos.exchange (0, std::memory_order_relaxed);
+            session.minNanos = juce::jmin (session.minNanos, window.minNanos);
+            session.maxNanos = juce::jmax (session.maxNanos, window.maxNanos);
+        }
+
+        // Message Thread
+        Stats getWindowStats() const  { return window.getStats(); }
+        Stats getSessionStats() const { return session.getStats(); }
+
+        void resetSession() { session = {}; }
+
+        // Message Thread: takes over everything old recorded that was not taken before, once nothing records into it
+        void absorb (Histogram& old)
+        {
+            old.collect();
+            window.add (old.window);
+            session.add (old.session);
+            old.window = {};
+            old.session = {};
+        }
+
+    private:
+        struct Counts
+        {
+            std::array<uint64_t, numBuckets> counts {};
+            uint64_t totalNanos = 0;
+            uint32_t minNanos = std::numeric_limits<uint32_t>::max(), maxNanos = 0;
+
+            void add (const Counts& other)
+            {
+                for (size_t i = 0; i < counts.size(); ++i)
+                    counts[i] += other.counts[i];
+                totalNanos += other.totalNanos;
+                minNanos = juce::jmin (minNanos, other.minNanos);
+                maxNanos = juce::jmax (maxNanos, other.maxNanos);
+            }
+
+            Stats getStats() const
+            {
+                Stats s;
+                for (auto c : counts) s.count += c;
+                if (s.count == 0) return s;
+
+                // Upper edge of the bucket holding the 99th percentile, kept inside the observed range
+                const auto rank = (s.count * 99 + 99) / 100;
+                uint64_t seen = 0;
+                int bucket = 0;
+                while ((seen += counts[(size_t) bucket]) < rank)
+                    ++bucket;
+
+                s.minMicros = minNanos * 0.001;
+                s.maxMicros = maxNanos * 0.001;
+                s.avgMicros = (double) totalNanos / (double) s.count * 0.001;
+                s.p99Micros = juce::jlimit (s.minMicros, s.maxMicros, (double) bucketUpperEdge (bucket) * 0.001);
+                return s;
+            }
+        };
+
+        static int bucketFor (uint32_t nanos)
+        {
+            if (nanos < 4) return (int) nanos;
+            const int octave = juce::findHighestSetBit (nanos);
+            return octave * 4 + (int) ((nanos >> (octave - 2)) & 3);
+        }
+
+        static uint64_t bucketUpperEdge (int bucket)
+        {
+            if (bucket < 8) return (uint64_t) bucket + 1;
+            const int octave = bucket / 4;
+            const uint64_t step = (uint64_t) 1 << (octave - 2);
+            return ((uint64_t) 1 << octave) + (uint64_t) (bucket % 4 + 1) * step;
+        }
+
+        std::array<std::atomic<uint64_t>, numBuckets> buckets {};
+        std::atomic<uint64_t> totalNanos { 0 };
+        std::atomic<uint32_t> minNanos { std::numeric_limits<uint32_t>::max() }, maxNanos { 0 };
+
+        // Message Thread
+        std::array<uint64_t, numBuckets> seenCounts {};
+        uint64_t seenTotalNanos = 0;
+        Counts window, session;
+    };
+
+    // One histogram per track of one mixer layout
+    struct TrackHistograms
+    {
+        TrackHistograms (int numTracks, uint32_t version)
+            : size (numTracks), layoutVersion (version), histograms (new Histogram[(size_t) numTracks]) {}
+
+        const int size;
+        const uint32_t layoutVersion;
+        std::unique_ptr<Histogram[]> histograms;
+    };
+
+    // Scoped timing of one track's render, on whichever thread renders it, during a callback.
+    // layoutVersion is that of the plan being rendered: a track is only timed into histograms
+    // made for the same layout. Does nothing without a profiler.
+    class TrackScope
+    {
+    public:
+        TrackScope (CallbackProfiler* p, int index, uint32_t layoutVersion)
+            : histogram (p != nullptr ? p->getTrackHistogram (index, layoutVersion) : nullptr), profiler (p),
+              startTicks (histogram != nullptr ? juce::Time::getHighResolutionTicks() : 0) {}
+
+        ~TrackScope()
+        {
+            if (histogram != nullptr)
+                histogram->record (profiler->ticksToNanos (juce::Time::getHighResolutionTicks() - startTicks));
+        }
+
+    private:
+        Histogram* histogram;
+        CallbackProfiler* profiler;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (TrackScope)
+    };
+
+    CallbackProfiler()
+        : nanosPerTick (1.0e9 / (double) juce::Time::getHighResolutionTicksPerSecond()),
+          tracks (std::make_unique<TrackHistograms> (0, 0))
+    {
+        publishedTracks.store (tracks.get());
+    }
+
+    // Message Thread, with the device stopped: a restart is not a late callback.
+    // Sizes the track histograms for the mixer's current layout.
+    void prepare (int numTracks, uint32_t layoutVersion)
+    {
+        callbackStartTicks = 0;
+        callbackTracks = nullptr;
+        startedTracks.store (nullptr);
+
+        auto next = std::make_unique<TrackHistograms> (numTracks, layoutVersion);
+        if (layoutVersion == tracks->layoutVersion)
+            for (int i = 0; i < juce::jmin (numTracks, tracks->size); ++i)
+                next->histograms[i].absorb (tracks->histograms[i]);
+
+        for (auto& old : retiredTracks)
+            if (old->layoutVersion == layoutVersion)
+                for (int i = 0; i < juce::jmin (numTracks, old->size); ++i)
+                    next->histograms[i].absorb (old->histograms[i]);
+
+        retiredTracks.clear();
+        tracks = std::move (next);
+        publishedTracks.store (tracks.get());
+    }
+
+    // Audio Thread: first thing in the callback
+    void beginCallback (int numSamples, double sampleRate)
+    {
+        // The track histograms for this whole callback. Once the message thread sees this one
+        // started, no callback is left that could record into an older set.
+        callbackTracks = publishedTracks.load (std::memory_order_acquire);
+        startedTracks.store (callbackTracks, std::memory_order_release);
+
+        const auto now = juce::Time::getHighResolutionTicks();
+
+        if (callbackStartTicks != 0 && periodTicks > 0 && now - callbackStartTicks > periodTicks + periodTicks / 2)
+            lateCallbacks.fetch_add (1, std::memory_order_relaxed);
+
+        callbackStartTicks = now;
+        periodTicks = sampleRate > 0.0 ? (juce::int64) (numSamples / sampleRate / nanosPerTick * 1.0e9) : 0;
+    }
+
+    // Audio Thread: last thing in the callback
+    void endCallback()
+    {
+        const auto elapsed = juce::Time::getHighResolutionTicks() - callbackStartTicks;
+        callbacks.record (ticksToNanos (elapsed));
+
+        busyNanos.fetch_add (ticksToNanos (elapsed), std::memory_order_relaxed);
+        periodNanos.fetch_add (ticksToNanos (periodTicks), std::memory_order_relaxed);
+
+        if (elapsed > periodTicks)
+            overruns.fetch_add (1, std::memory_order_relaxed);
+
+        if (periodTicks > 0)
+        {
+            const auto load = (uint32_t) juce::jmin<juce::int64> (elapsed * 1000 / periodTicks, std::numeric_limits<uint32_t>::max());
+            auto peak = peakLoadPermille.load (std::memory_order_relaxed);
+            while (load > peak && ! peakLoadPermille.compare_exchange_weak (peak, load, std::memory_order_relaxed)) {}
+        }
+    }
+
+    // Message Thread: follows the mixer's track layout, then takes the window since the last
+    // collect(). Call before reading anything below.
+    void collect (int numTracks, uint32_t layoutVersion)
+    {
+        followLayout (numTracks, layoutVersion);
+
+        callbacks.collect();
+        for (int i = 0; i < tracks->size; ++i)
+            tracks->histograms[i].collect();
+        releaseRetiredTracks();
+
+        const auto busy = busyNanos.load (std::memory_order_relaxed);
+        const auto period = periodNanos.load (std::memory_order_relaxed);
+        windowLoad = period > seenPeriodNanos ? (double) (busy - seenBusyNanos) / (double) (period - seenPeriodNanos) : 0.0;
+        sessionLoad = period > 0 ? (double) busy / (double) period : 0.0;
+        seenBusyNanos = busy;
+        seenPeriodNanos = period;
+
+        windowPeakLoad = peakLoadPermille.exchange (0, std::memory_order_relaxed) * 0.001;
+        sessionPeakLoad = juce::jmax (sessionPeakLoad, windowPeakLoad);
+    }
+
+    // Message Thread: the last window, for the UI update
+    juce::var toVar (int numTracks) const
+    {
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        obj->setProperty ("load", windowLoad * 100.0);
+        obj->setProperty ("peakLoad", windowPeakLoad * 100.0);
+        obj->setProperty ("late", (juce::int64) getNumLateCallbacks());
+        obj->setProperty ("overruns", (juce::int64) getNumOverruns());
+        obj->setProperty ("callback", statsToVar (callbacks.getWindowStats()));
+
+        juce::Array<juce::var> tracksArray;
+        for (int i = 0; i < juce::jmin (tracks->size, numTracks); ++i)
+        {
+            const auto stats = tracks->histograms[i].getWindowStats();
+            if (stats.count == 0) continue;
+
+            auto t = statsToVar (stats);
+            t.getDynamicObject()->setProperty ("i", i);
+            tracksArray.add (t);
+        }
+        obj->setProperty ("tracks", tracksArray);
+        return juce::var (obj.get());
+    }
+
+    // Message Thread: plain-text report of the whole session, slowest track first
+    bool writeReport (const juce::File& file, const juce::StringArray& trackNames, int deviceXruns) const
+    {
+        juce::String report;
+        report << "MusicMaker callback profile, " << juce::Time::getCurrentTime().toString (true, true) << "\n\n"
+               << "DSP load       avg " << juce::String (sessionLoad * 100.0, 1) << "%, peak " << juce::String (sessionPeakLoad * 100.0, 1) << "%\n"
+               << "Late callbacks " << (juce::int64) getNumLateCallbacks() << "\n"
+               << "Overruns       " << (juce::int64) getNumOverruns() << "\n"
+               << "Device xruns   " << (deviceXruns >= 0 ? juce::String (deviceXruns) : juce::String ("not reported")) << "\n\n"
+               << "                        count      min us      avg us      p99 us      max us\n";
+        formatRow (report, "Callback", callbacks.getSessionStats());
+
+        std::vector<std::pair<Stats, int>> rows;
+        for (int i = 0; i < juce::jmin (tracks->size, trackNames.size()); ++i)
+            if (const auto stats = tracks->histograms[i].getSessionStats(); stats.count > 0)
+                rows.push_back ({ stats, i });
+
+        std::sort (rows.begin(), rows.end(), [] (const auto& a, const auto& b) { return a.first.p99Micros > b.first.p99Micros; });
+        for (const auto& [stats, index] : rows)
+            formatRow (report, juce::String (index + 1) + " " + trackNames[index], stats);
+
+        return file.replaceWithText (report);
+    }
+
+    // Message Thread
+    void resetSession()
+    {
+        callbacks.resetSession();
+        for (int i = 0; i < tracks->size; ++i)
+            tracks->histograms[i].resetSession();
+        for (auto& old : retiredTracks)
+            for (int i = 0; i < old->size; ++i)
+                old->histograms[i].resetSession();
+        sessionPeakLoad = 0.0;
+    }
+
+    uint64_t getNumLateCallbacks() const { return lateCallbacks.load (std::memory_order_relaxed); }
+    uint64_t getNumOverruns() const      { return overruns.load (std::memory_order_relaxed); }
+
+private:
+    // Audio Thread or render worker, during a callback
+    Histogram* getTrackHistogram (int index, uint32_t layoutVersion) const
+    {
+        const auto* set = callbackTracks;
+        if (set == nullptr || set->layoutVersion != layoutVersion || ! juce::isPositiveAndBelow (index, set->size))
+            return nullptr;
+        return &set->histograms[index];
+    }
+
+    // Message Thread: a new layout starts with empty histograms, added tracks keep the history of the others
+    void followLayout (int numTracks, uint32_t layoutVersion)
+    {
+        if (layoutVersion == tracks->layoutVersion && numTracks <= tracks->size)
+            return;
+
+        auto next = std::make_unique<TrackHistograms> (numTracks, layoutVersion);
+        if (layoutVersion == tracks->layoutVersion)
+            for (int i = 0; i < tracks->size; ++i)
+                next->histograms[i].absorb (tracks->histograms[i]);
+
+        retiredTracks.push_back (std::move (tracks));
+        tracks = std::move (next);
+        publishedTracks.store (tracks.get(), std::memory_order_release);
+    }
+
+    // Message Thread: frees the sets no callback can still be recording into, keeping
+    // what they recorded since they were retired if the layout is the same
+    void releaseRetiredTracks()
+    {
+        if (retiredTracks.empty() || startedTracks.load (std::memory_order_acquire) != tracks.get())
+            return;
+
+        for (auto& old : retiredTracks)
+            if (old->layoutVersion == tracks->layoutVersion)
+                for (int i = 0; i < juce::jmin (tracks->size, old->size); ++i)
+                    tracks->histograms[i].absorb (old->histograms[i]);
+
+        retiredTracks.clear();
+    }
+
+    uint32_t ticksToNanos (juce::int64 ticks) const
+    {
+        return (uint32_t) juce::jlimit (0.0, (double) std::numeric_limits<uint32_t>::max(), (double) ticks * nanosPerTick);
+    }
+
+    static juce::var statsToVar (const Stats& s)
+    {
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        obj->setProperty ("min", s.minMicros);
+        obj->setProperty ("avg", s.avgMicros);
+        obj->setProperty ("p99", s.p99Micros);
+        obj->setProperty ("max", s.maxMicros);
+        return juce::var (obj.get());
+    }
+
+    static void formatRow (juce::String& out, const juce::String& name, const Stats& s)
+    {
+        out << name.substring (0, 20).paddedRight (' ', 20)
+            << juce::String ((juce::int64) s.count).paddedLeft (' ', 10);
+        for (auto v : { s.minMicros, s.avgMicros, s.p99Micros, s.maxMicros })
+            out << juce::String (v, 1).paddedLeft (' ', 12);
+        out << "\n";
+    }
+
+    const double nanosPerTick;
+
+    // Audio Thread; render workers read callbackTracks during the callback
+    juce::int64 callbackStartTicks = 0, periodTicks = 0;
+    TrackHistograms* callbackTracks = nullptr;
+
+    Histogram callbacks;
+    std::atomic<TrackHistograms*> publishedTracks { nullptr }, startedTracks { nullptr };
+    std::atomic<uint64_t> busyNanos { 0 }, periodNanos { 0 };
+    std::atomic<uint64_t> lateCallbacks { 0 }, overruns { 0 };
+    std::atomic<uint32_t> peakLoadPermille { 0 };
+
+    // Message Thread
+    std::unique_ptr<TrackHistograms> tracks;
+    std::vector<std::unique_ptr<TrackHistograms>> retiredTracks;
+    uint64_t seenBusyNanos = 0, seenPeriodNanos = 0;
+    double windowLoad = 0.0, windowPeakLoad = 0.0;
+    double sessionLoad = 0.0, sessionPeakLoad = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE (CallbackProfiler)
+};
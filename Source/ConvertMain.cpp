@@ -0,0 +1,88 @@
+#include <JuceHeader.h>
+#include "ProjectJson.h"
+#include "ProjectBinary.h"
+#include <iostream>
+
+// Project converter: MusicMakerConvert <input> <output>
+// The input format is detected from its contents, the output format from its extension
+// (.json writes the AI bridge JSON, anything else the binary .mmproj container).
+static void printUsage()
+{
+    std::cout << "Usage: MusicMakerConvert <input.json|.mmproj> <output.json|.mmproj>\n";
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    juce::StringArray positional;
+    for (auto& arg : args.arguments)
+        if (! arg.isOption())
+            positional.add (arg.text);
+
+    if (args.containsOption ("--help|-h") || positional.size() < 2)
+    {
+        printUsage();
+        return positional.size() < 2 ? 1 : 0;
+    }
+
+    auto inputFile = juce::File::getCurrentWorkingDirectory().getChildFile (positional[0]);
+    auto outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (positional[1]);
+
+    if (! inputFile.existsAsFile())
+    {
+        std::cerr << "Project not found: " << inputFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    // Plain instrument tracks carry the synth params; no processors are needed to convert
+    ProjectModel model;
+    Transport transport;
+    Mixer mixer;
+    auto addTracks = [&] (int numTracks) {
+        for (int i = mixer.getNumTracks(); i < numTracks; ++i)
+            mixer.addTrack (std::make_unique<InstrumentTrack> ("Track " + juce::String (i + 1)));
+    };
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    bool loaded = false;
+
+    if (ProjectBinary::isBinaryProject (inputFile))
+    {
+        ProjectBinary::Reader reader (inputFile);
+        addTracks (reader.getNumTracks());
+        loaded = reader.load (model, transport, mixer);
+    }
+    else
+    {
+        auto project = juce::JSON::parse (inputFile.loadFileAsString());
+        addTracks (ProjectJson::getNumTracks (project));
+        loaded = ProjectJson::load (project, model, transport, mixer);
+    }
+
+    if (! loaded)
+    {
+        std::cerr << "Not a valid project: " << inputFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    const double loadSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+    const bool written = outputFile.hasFileExtension ("json")
+                           ? outputFile.replaceWithText (ProjectJson::toJson (model, transport, mixer))
+                           : ProjectBinary::write (outputFile, model, transport, mixer);
+
+    if (! written)
+    {
+        std::cerr << "Failed to write " << outputFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    size_t numNotes = 0;
+    for (const auto& [index, notes] : model.getAllNotes())
+        numNotes += notes.size();
+
+    std::cout << "Converted " << mixer.getNumTracks() << " tracks, " << numNotes << " notes (loaded in "
+              << loadSeconds * 1000.0 << " ms)\n";
+    return 0;
+}
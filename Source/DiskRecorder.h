@@ -0,0 +1,210 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One recording: a range of input channels, copied into a ring on the audio thread and written
+// to one file by the DiskRecorder's thread. The ring is the only memory a take holds, so a take
+// of any length costs the same RAM.
+class RecordTake
+{
+public:
+    static constexpr int maxChannels = 2;
+
+    RecordTake (std::unique_ptr<juce::AudioFormatWriter> fileWriter, const juce::File& f, int firstInputChannel, int numInputChannels, int ringFrames)
+        : file (f), firstInput (firstInputChannel), numChannels (juce::jlimit (1, maxChannels, numInputChannels)),
+          fifo (ringFrames), ring (numChannels, ringFrames), writer (std::move (fileWriter))
+    {
+    }
+
+    // Audio Thread: copies this take's input channels into the ring. A block that does not fit is
+    // dropped whole and counted rather than split, so what reaches the file is never torn mid-block.
+    void write (const juce::AudioBuffer<float>& input, int startSample, int numSamples)
+    {
+        if (fifo.getFreeSpace() < numSamples)
+        {
+            droppedBlocks.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const int source = firstInput + channel;
+            if (source < input.getNumChannels())
+            {
+                ring.copyFrom (channel, start1, input, source, startSample, size1);
+                if (size2 > 0) ring.copyFrom (channel, start2, input, source, startSample + size1, size2);
+            }
+            else
+            {
+                ring.clear (channel, start1, size1);
+                if (size2 > 0) ring.clear (channel, start2, size2);
+            }
+        }
+        fifo.finishedWrite (size1 + size2);
+
+        const int ready = fifo.getNumReady();
+        if (ready > highWater.load (std::memory_order_relaxed))
+            highWater.store (ready, std::memory_order_relaxed);
+    }
+
+    // Once the audio thread can no longer call write(): the writer drains the ring and closes the file
+    void release() { released.store (true, std::memory_order_release); }
+
+    // Any thread
+    bool isFinished() const { return finished.load (std::memory_order_acquire); }
+    bool hasFailed() const { return failed.load(); }
+    const juce::File& getFile() const { return file; }
+    juce::int64 getNumSamplesWritten() const { return samplesWritten.load(); }
+    uint64_t getNumDroppedBlocks() const { return droppedBlocks.load(); }
+    float getHighWater() const { return highWater.load() / (float) fifo.getTotalSize(); } // Fullest the ring has been, 0..1
+
+private:
+    friend class DiskRecorder;
+
+    const juce::File file;
+    const int firstInput, numChannels;
+
+    juce::AbstractFifo fifo;
+    juce::AudioBuffer<float> ring;
+    std::unique_ptr<juce::AudioFormatWriter> writer; // Writer thread only
+
+    std::atomic<bool> released { false }, finished { false }, failed { false };
+    std::atomic<int> highWater { 0 };
+    std::atomic<uint64_t> droppedBlocks { 0 };
+    std::atomic<juce::int64> samplesWritten { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (RecordTake)
+};
+
+// Streams every running take to disk on one background thread. The audio thread only ever copies
+// into a take's ring; the file is written here in large sequential chunks, so the disk sees few,
+// big writes and a stall of up to ringSeconds costs nothing.
+class DiskRecorder : private juce::Thread
+{
+public:
+    static constexpr int ringSeconds = 8;     // How long the disk may stall before blocks are dropped
+    static constexpr int writeFrames = 32768; // Per write, and at least this much is gathered before writing
+
+    struct Counters
+    {
+        int activeTakes = 0;
+        float highWater = 0.0f; // Fullest ring of a running take, 0..1
+        uint64_t droppedBlocks = 0;
+    };
+
+    DiskRecorder() : juce::Thread ("DiskRecorder") { startThread(); }
+
+    // Anything still running is written out and closed
+    ~DiskRecorder() override { stopThread (10000); }
+
+    // Message Thread: a take recording numChannels inputs from firstInput into file, or nullptr if
+    // the file cannot be created. WAV files switch to RF64 by themselves once they pass 4 GB.
+    std::shared_ptr<RecordTake> startTake (const juce::File& file, int firstInput, int numChannels, double sampleRate)
+    {
+        if (sampleRate <= 0.0) return nullptr;
+
+        file.deleteFile();
+        auto stream = file.createOutputStream (fileBufferSize); // Large, so the writer's small writes reach the disk in big ones
+        if (stream == nullptr) return nullptr;
+
+        numChannels = juce::jlimit (1, RecordTake::maxChannels, numChannels);
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate, (unsigned int) numChannels, 32, {}, 0));
+        if (writer == nullptr) return nullptr;
+        stream.release(); // The writer owns the stream now
+
+        const int ringFrames = juce::jmax (2 * writeFrames, (int) (sampleRate * ringSeconds));
+        auto take = std::make_shared<RecordTake> (std::move (writer), file, juce::jmax (0, firstInput), numChannels, ringFrames);
+
+        std::lock_guard<std::mutex> lock (takesMutex);
+        takes.push_back (take);
+        return take;
+    }
+
+    // Any thread
+    Counters getCounters() const
+    {
+        std::lock_guard<std::mutex> lock (takesMutex);
+        Counters c;
+        c.activeTakes = (int) takes.size();
+        c.droppedBlocks = droppedInFinishedTakes;
+        for (auto& take : takes)
+        {
+            c.highWater = juce::jmax (c.highWater, take->getHighWater());
+            c.droppedBlocks += take->getNumDroppedBlocks();
+        }
+        return c;
+    }
+
+private:
+    static constexpr int fileBufferSize = 1 << 20;
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            service (false);
+            wait (20);
+        }
+        service (true);
+    }
+
+    void service (bool closeAll)
+    {
+        std::vector<std::shared_ptr<RecordTake>> current;
+        {
+            std::lock_guard<std::mutex> lock (takesMutex);
+            current = takes;
+        }
+
+        for (auto& take : current)
+        {
+            const bool closing = closeAll || take->released.load (std::memory_order_acquire); // Read before the ring, so nothing is left behind
+            int ready;
+            while ((ready = take->fifo.getNumReady()) >= writeFrames || (closing && ready > 0))
+                writeChunk (*take, juce::jmin (ready, writeFrames));
+
+            if (! closing) continue;
+
+            take->writer.reset(); // Flushes and finalises the header
+            take->finished.store (true, std::memory_order_release);
+
+            std::lock_guard<std::mutex> lock (takesMutex);
+            droppedInFinishedTakes += take->getNumDroppedBlocks();
+            takes.erase (std::find (takes.begin(), takes.end(), take));
+        }
+    }
+
+    void writeChunk (RecordTake& take, int numFrames)
+    {
+        int start1, size1, start2, size2;
+        take.fifo.prepareToRead (numFrames, start1, size1, start2, size2);
+
+        auto writeRegion = [&take] (int start, int size) {
+            if (size <= 0 || take.writer == nullptr) return;
+            const float* channels[RecordTake::maxChannels] {};
+            for (int channel = 0; channel < take.numChannels; ++channel)
+                channels[channel] = take.ring.getReadPointer (channel, start);
+            if (! take.writer->writeFromFloatArrays (channels, take.numChannels, size))
+                take.failed.store (true);
+        };
+        writeRegion (start1, size1);
+        writeRegion (start2, size2);
+
+        take.fifo.finishedRead (size1 + size2);
+        take.samplesWritten.fetch_add (size1 + size2);
+    }
+
+    mutable std::mutex takesMutex; // Message and writer thread only
+    std::vector<std::shared_ptr<RecordTake>> takes;
+    uint64_t droppedInFinishedTakes = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (DiskRecorder)
+};
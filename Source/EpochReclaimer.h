@@ -0,0 +1,143 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Deferred reclamation for data published to the audio thread (RCU style).
+// The audio thread pins the current epoch while it reads published pointers;
+// writers retire the objects they replaced, and collect() frees them on a
+// non-audio thread once no pinned reader can still reference them.
+class EpochReclaimer
+{
+    struct ReaderSlot;
+
+public:
+    static constexpr int maxReaders = 16; // Threads pinning at once: the audio thread, offline renders
+
+    // Any thread: hold one of these for as long as published pointers are in use. Each
+    // pinning thread gets a reader slot of its own; a scope opened inside another on the
+    // same thread keeps the outer, older pin, and the slot is released with the outermost.
+    class ReadScope
+    {
+    public:
+        explicit ReadScope (const EpochReclaimer& r) : slot (r.acquireSlot())
+        {
+            if (slot.depth++ == 0)
+                slot.epoch.store (r.globalEpoch.load());
+        }
+
+        ~ReadScope()
+        {
+            jassert (slot.owner.load() == std::this_thread::get_id()); // Scopes end on the thread that opened them
+            if (--slot.depth == 0)
+            {
+                slot.epoch.store (idle);
+                slot.owner.store (std::thread::id());
+            }
+        }
+
+    private:
+        ReaderSlot& slot;
+        JUCE_DECLARE_NON_COPYABLE (ReadScope)
+    };
+
+    EpochReclaimer() = default;
+    ~EpochReclaimer() = default; // Anything still retired is freed with the list
+
+    // Message Thread: call after the replacement has been published
+    template <typename T>
+    void retire (const T* object)
+    {
+        if (object == nullptr) return;
+
+        std::lock_guard<std::mutex> lock (retiredMutex);
+        retired.push_back ({ std::shared_ptr<const void> (object), globalEpoch.fetch_add (1) });
+    }
+
+    // Message Thread: for objects that are also owned elsewhere, e.g. by an undo history.
+    // Only this reference is dropped once no reader can still see the object.
+    void retire (std::shared_ptr<const void> object)
+    {
+        if (object == nullptr) return;
+
+        std::lock_guard<std::mutex> lock (retiredMutex);
+        retired.push_back ({ std::move (object), globalEpoch.fetch_add (1) });
+    }
+
+    // Message Thread: frees everything no reader can still see
+    void collect()
+    {
+        auto pinned = idle;
+        for (const auto& slot : readers)
+            pinned = std::min (pinned, slot.epoch.load());
+
+        std::vector<Retired> reclaimable;
+
+        {
+            std::lock_guard<std::mutex> lock (retiredMutex);
+            auto firstLive = std::partition (retired.begin(), retired.end(), [pinned] (const Retired& r) {
+                return r.epoch < pinned;
+            });
+            reclaimable.assign (std::make_move_iterator (retired.begin()), std::make_move_iterator (firstLive));
+            retired.erase (retired.begin(), firstLive);
+        }
+        // reclaimable is destroyed here, outside the lock
+    }
+
+    size_t getNumPending() const
+    {
+        std::lock_guard<std::mutex> lock (retiredMutex);
+        return retired.size();
+    }
+
+private:
+    struct Retired
+    {
+        std::shared_ptr<const void> object;
+        uint64_t epoch;
+    };
+
+    static constexpr uint64_t idle = std::numeric_limits<uint64_t>::max();
+
+    struct ReaderSlot
+    {
+        std::atomic<std::thread::id> owner { std::thread::id() };
+        std::atomic<uint64_t> epoch { idle };
+        int depth = 0; // Only the owning thread touches it
+    };
+
+    // The calling thread's slot, claiming a free one if it has none. Lock-free: a scan of maxReaders slots.
+    ReaderSlot& acquireSlot() const
+    {
+        const auto self = std::this_thread::get_id();
+        for (auto& slot : readers)
+            if (slot.owner.load() == self)
+                return slot;
+
+        for (;;)
+        {
+            for (auto& slot : readers)
+            {
+                auto expected = std::thread::id();
+                if (slot.owner.compare_exchange_strong (expected, self))
+                    return slot;
+            }
+            jassertfalse; // More than maxReaders threads pinning at once: wait for one to finish
+            std::this_thread::yield();
+        }
+    }
+
+    mutable std::atomic<uint64_t> globalEpoch { 0 };
+    mutable ReaderSlot readers[maxReaders];
+
+    mutable std::mutex retiredMutex;
+    std::vector<Retired> retired;
+
+    JUCE_DECLARE_NON_COPYABLE (EpochReclaimer)
+};
@@ -1,7 +1,8 @@
 #pragma once
 
 #include <JuceHeader.h>
-#include "SynthEngine.h"
+#include "VoiceBank.h"
+#include "SmoothedParameter.h"
 
 class InternalSynthProcessor : public juce::AudioProcessor
 {
@@ -9,42 +10,76 @@ public:
     InternalSynthProcessor()
         : AudioProcessor (BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true))
     {
-        for (int i = 0; i < 8; ++i)
-            synth.addVoice (new SynthVoice()); // This requires SynthVoice to be accessible
-        
-        synth.addSound (new SynthSound());
     }
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override
     {
-        synth.setCurrentPlaybackSampleRate (sampleRate);
-        for (int i = 0; i < synth.getNumVoices(); ++i)
-            if (auto* v = dynamic_cast<SynthVoice*> (synth.getVoice(i)))
-                v->prepare (sampleRate);
+        cutoff.prepare (sampleRate, 0.05);
+        resonance.prepare (sampleRate, 0.05);
+
+        voices.prepare (sampleRate);
+        voices.setWaveform ((Waveform) waveform.load());
+        voices.setFilter (cutoff.getCurrent(), resonance.getCurrent());
     }
 
     void releaseResources() override {}
 
+    // Renders between MIDI events so every note starts and stops on its exact sample
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
     {
-        synth.renderNextBlock (buffer, midiMessages, 0, buffer.getNumSamples());
+        const int numSamples = buffer.getNumSamples();
+        int position = 0;
+
+        if (cutRequested.exchange (false))
+            voices.allNotesOff (false);
+
+        voices.setWaveform ((Waveform) waveform.load());
+        cutoff.beginBlock();
+        resonance.beginBlock();
+
+        for (const auto metadata : midiMessages)
+        {
+            const int eventPosition = juce::jlimit (0, numSamples, metadata.samplePosition);
+            if (eventPosition > position)
+            {
+                renderRange (buffer, position, eventPosition);
+                position = eventPosition;
+            }
+            handleMidiEvent (metadata.getMessage());
+        }
+
+        if (position < numSamples)
+            renderRange (buffer, position, numSamples);
     }
 
     void noteOn (int midiNoteNumber, float velocity)
     {
-        synth.noteOn (1, midiNoteNumber, velocity);
+        voices.noteOn (midiNoteNumber, velocity);
     }
 
     void noteOff (int midiNoteNumber, float velocity, bool allowTailOff)
     {
-        synth.noteOff (1, midiNoteNumber, velocity, allowTailOff);
+        voices.noteOff (midiNoteNumber, allowTailOff);
     }
 
-    void allNotesOff()
+    // Any thread: voices are cut at the start of the next block, on the thread that renders them
+    void allNotesOff() { cutRequested.store (true); }
+
+    int getNumActiveVoices() const { return voices.getNumActiveVoices(); }
+
+    // Message Thread, before the processor is handed to a track: the table the Table waveform plays.
+    // Shared read-only with every other patch using the same file, and held as long as this one is.
+    void setWavetable (std::shared_ptr<const Wavetable> table)
     {
-        synth.allNotesOff (0, false); // Channel 0 (all channels), allowTailOff = false
+        wavetable = std::move (table);
+        voices.setUserWavetable (wavetable.get());
     }
 
+    const std::shared_ptr<const Wavetable>& getWavetable() const { return wavetable; }
+
+    // The Mixer's VoicePool grants this bank its voices each block
+    VoiceBank& getVoiceBank() { return voices; }
+
     // Boilerplate
     const juce::String getName() const override { return "Internal Synth"; }
     bool acceptsMidi() const override { return true; }
@@ -60,14 +95,51 @@ public:
     void getStateInformation (juce::MemoryBlock&) override {}
     void setStateInformation (const void*, int) override {}
 
-    void updateParameters (int type, float cutoff, float resonance)
+    // Message Thread: only stores targets; the audio thread picks them up at the next block
+    void updateParameters (int type, float newCutoff, float newResonance)
     {
-        for (int i = 0; i < synth.getNumVoices(); ++i)
-            if (auto* v = dynamic_cast<SynthVoice*> (synth.getVoice(i)))
-                v->updateParameters (type, cutoff, resonance);
+        waveform.store (juce::jlimit (0, (int) Waveform::wavetable, type));
+        cutoff.set (juce::jlimit (20.0f, 20000.0f, newCutoff));
+        resonance.set (juce::jlimit (0.1f, 20.0f, newResonance));
     }
 
 private:
-    juce::Synthesiser synth;
+    static constexpr int controlInterval = 32; // Samples between filter coefficient updates while a knob moves
+
+    void renderRange (juce::AudioBuffer<float>& buffer, int start, int end)
+    {
+        if (! cutoff.isSmoothing() && ! resonance.isSmoothing())
+        {
+            voices.render (buffer, start, end - start);
+            return;
+        }
+
+        while (start < end)
+        {
+            const int n = juce::jmin (end - start, controlInterval);
+            if (cutoff.isSmoothing() || resonance.isSmoothing())
+                voices.setFilter (cutoff.skip (n), resonance.skip (n));
+
+            voices.render (buffer, start, n);
+            start += n;
+        }
+    }
+
+    // Same handling as juce::Synthesiser: note off and all-notes-off let voices release, all-sound-off cuts them
+    void handleMidiEvent (const juce::MidiMessage& m)
+    {
+        if (m.isNoteOn())              voices.noteOn (m.getNoteNumber(), m.getFloatVelocity());
+        else if (m.isNoteOff())        voices.noteOff (m.getNoteNumber(), true);
+        else if (m.isAllNotesOff())    voices.allNotesOff (true);
+        else if (m.isAllSoundOff())    voices.allNotesOff (false);
+    }
+
+    VoiceBank voices; // Up to 64 voices
+    std::shared_ptr<const Wavetable> wavetable;
+    std::atomic<bool> cutRequested { false };
+
+    std::atomic<int> waveform { 1 }; // Default Saw
+    SmoothedParameter<juce::ValueSmoothingTypes::Multiplicative> cutoff { 2000.0f };
+    SmoothedParameter<> resonance { 0.7f };
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InternalSynthProcessor)
 };
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "MpscRing.h"
+#include <atomic>
+#include <cstring>
+
+// Live MIDI on its way from the devices and the on-screen keyboard to the audio thread, and back.
+//
+// In: any thread posts the message bytes with their arrival time into a preallocated ring. At the
+// start of each callback the audio thread drains it and places every event at the offset that
+// matches when it arrived during the previous callback period. Every event is therefore late by
+// the same one period, not by whatever happened to be left of the block it landed in, so fast
+// passages keep their timing.
+// Back: the audio thread reports each note it let through, with the beat it sounded on, through a
+// second ring. The message thread drains that once per frame to commit recorded notes in batches
+// and update the UI, so the device thread never locks, allocates or touches the model.
+class LiveMidiInput
+{
+public:
+    struct Event
+    {
+        double time = 0.0; // Seconds, on the Time::getMillisecondCounterHiRes() clock
+        juce::uint8 data[3] {};
+        juce::uint8 size = 0;
+        bool fromDevice = false;
+
+        bool isNoteOn() const  { return (data[0] & 0xf0) == 0x90 && data[2] > 0; }
+        bool isNoteOff() const { return (data[0] & 0xf0) == 0x80 || ((data[0] & 0xf0) == 0x90 && data[2] == 0); }
+    };
+
+    // A note as the audio thread played it
+    struct PlayedNote
+    {
+        int track = -1;
+        int note = 0;
+        float velocity = 0.0f; // 0 for a note-off
+        double beat = 0.0;
+        bool recorded = false; // The transport was recording
+        bool fromDevice = false;
+    };
+
+    // Any thread. JUCE stamps MidiInput messages on the same clock; unstamped ones count as arriving now.
+    // Messages longer than three bytes (sysex) are not played, so they are not queued.
+    void post (const juce::MidiMessage& message, bool fromDevice)
+    {
+        const int size = message.getRawDataSize();
+        if (size <= 0 || size > 3) return;
+
+        Event e;
+        e.time = message.getTimeStamp() > 0.0 ? message.getTimeStamp() : now();
+        std::memcpy (e.data, message.getRawData(), (size_t) size);
+        e.size = (juce::uint8) size;
+        e.fromDevice = fromDevice;
+
+        if (! incoming.push (e))
+            droppedEvents.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    // Message Thread, with the device stopped
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        lastDrainTime = 0.0;
+    }
+
+    // Audio Thread, once per callback: handle (const Event&, int sampleOffset) for everything queued, in arrival order
+    template <typename Handler>
+    void drain (int numSamples, Handler&& handle)
+    {
+        if (numSamples <= 0 || sampleRate <= 0.0) return;
+
+        const double end = now();
+        const double period = numSamples / sampleRate;
+
+        // The first callback, or one after a stall: assume a regular period rather than stretch the events over the gap
+        double start = lastDrainTime;
+        if (end - start <= 0.0 || end - start > 4.0 * period)
+            start = end - period;
+        lastDrainTime = end;
+
+        const double samplesPerSecond = numSamples / (end - start);
+        Event e;
+        while (incoming.pop (e))
+            handle (e, juce::jlimit (0, numSamples - 1, (int) ((e.time - start) * samplesPerSecond)));
+    }
+
+    // Audio Thread
+    void report (const PlayedNote& note)
+    {
+        if (! played.push (note))
+            droppedNotes.fetch_add (1, std::memory_order_relaxed);
+    }
+
+    // Message Thread
+    bool nextPlayedNote (PlayedNote& note) { return played.pop (note); }
+
+    // Events lost because a ring was full
+    uint64_t getNumDropped() const { return droppedEvents.load() + droppedNotes.load(); }
+
+    static double now() { return juce::Time::getMillisecondCounterHiRes() * 0.001; }
+
+private:
+    static constexpr size_t capacity = 1024; // Several seconds of the densest playing
+
+    MpscRing<Event, capacity> incoming;
+    MpscRing<PlayedNote, capacity> played;
+    std::atomic<uint64_t> droppedEvents { 0 }, droppedNotes { 0 };
+
+    // Audio Thread
+    double sampleRate = 0.0;
+    double lastDrainTime = 0.0;
+};
@@ -1,5 +1,8 @@
 #include "MainComponent.h"
 #include "RealTimeLogger.h"
+#include "ProjectJson.h"
+#include "ProjectBinary.h"
+#include "Sequencer.h"
 
 MainComponent::MainComponent()
 {
@@ -12,6 +15,7 @@ MainComponent::MainComponent()
     auto track = std::make_unique<InstrumentTrack> ("Lead Synth");
     track->setInstrument (std::move (synthProc));
     mixer.addTrack (std::move (track));
+    mixer.setProfiler (&profiler);
 
     auto midiInputs = juce::MidiInput::getAvailableDevices();
     for (auto& input : midiInputs)
@@ -29,8 +33,8 @@ MainComponent::MainComponent()
             int note = params["note"];
             float vel = params["velocity"];
             
-            if (vel > 0) postMidiToEngine(juce::MidiMessage::noteOn(1, note, vel));
-            else        postMidiToEngine(juce::MidiMessage::noteOff(1, note, 0.0f));
+            if (vel > 0) liveInput.post (juce::MidiMessage::noteOn (1, note, vel), false);
+            else         liveInput.post (juce::MidiMessage::noteOff (1, note, 0.0f), false);
         })
         .withEventListener ("editEvent", [this] (juce::var params) {
             juce::String type = params["type"];
@@ -48,6 +52,11 @@ MainComponent::MainComponent()
                 RealTimeLogger::log("Grid Remove from Track " + juce::String(selectedTrackIndex + 1) + ": " + juce::String(note) + " at " + juce::String(quantizedBeat, 2));
             }
         })
+        .withEventListener ("syncEvent", [this] (juce::var params) {
+            // The page (re)loaded or missed an update
+            if (params["command"].toString() == "resync")
+                uiSync.requestFullSync();
+        })
         .withEventListener ("audioDeviceEvent", [this] (juce::var params) {
             juce::String cmd = params["command"];
             if (cmd == "list") {
@@ -80,23 +89,37 @@ MainComponent::MainComponent()
             if (cmd == "play")       transport.setPlaying (true);
             else if (cmd == "stop")  { 
                 transport.setPlaying (false); 
+                stopAudioTakes();
                 transport.reset(); 
                 mixer.allNotesOff();
                 RealTimeLogger::log ("Transport Stopped");
             }
             else if (cmd == "record") {
                 bool val = (bool)params["value"];
+                if (!val) {
+                    drainLiveInput(); // Notes that ended before the stop are still committed
+                    activeRecordingNotes.clear();
+                    stopAudioTakes();
+                }
                 transport.setRecording (val);
-                if (!val) activeRecordingNotes.clear();
+                if (val) startAudioTakes();
                 RealTimeLogger::log (val ? "Recording Armed" : "Recording Stopped");
             }
             else if (cmd == "bpm")   transport.setBpm ((double)params["value"]);
+            else if (cmd == "loop") {
+                transport.setLoopRegion ((double)params["start"], (double)params["end"]);
+                RealTimeLogger::log ("Loop: " + juce::String(transport.getLoopStart(), 2) + " - " + juce::String(transport.getLoopEnd(), 2));
+            }
             else if (cmd == "metronome") {
                 metronomeEnabled = (bool)params["value"];
                 RealTimeLogger::log (juce::String("Metronome: ") + (metronomeEnabled ? "ON" : "OFF"));
             }
             else if (cmd == "clear") { model.clear(); RealTimeLogger::log("Project Cleared"); }
+            else if (cmd == "undo")  { if (model.undo()) RealTimeLogger::log("Undo"); }
+            else if (cmd == "redo")  { if (model.redo()) RealTimeLogger::log("Redo"); }
             else if (cmd == "save")  saveProject();
+            else if (cmd == "open")  openProject();
+            else if (cmd == "profile") dumpProfile();
             else if (cmd == "export") {
                 webBrowser->evaluateJavascript("if(window.onExport) window.onExport(" + getFullProjectJson() + ");");
             }
@@ -110,8 +133,12 @@ MainComponent::MainComponent()
             
             if (cmd == "addTrack") {
                 juce::String name = params["name"];
+                if (params["kind"].toString() == "audio") {
+                    mixer.addTrack (std::make_unique<AudioTrack> (name));
+                    RealTimeLogger::log ("Added Audio Track: " + name);
+                    return;
+                }
                 auto synthProc = std::make_unique<InternalSynthProcessor>();
-                if (currentSampleRate > 0) synthProc->prepareToPlay(currentSampleRate, 512);
                 auto t = std::make_unique<InstrumentTrack> (name);
                 t->setInstrument (std::move (synthProc));
                 mixer.addTrack (std::move (t));
@@ -119,6 +146,57 @@ MainComponent::MainComponent()
                 return;
             }
 
+            if (cmd == "removeTrack") {
+                const int index = params["trackIndex"];
+                if (auto* track = mixer.getTrack (index)) {
+                    const auto name = track->getName();
+                    // Notes first: the Mixer silences every track once it publishes the new layout,
+                    // so notes started while the two disagreed cannot hang
+                    model.removeTrack (index);
+                    mixer.removeTrack (index);
+                    activeRecordingNotes.clear(); // Their track indices may have moved
+                    selectTrack (juce::jmin (selectedTrackIndex, mixer.getNumTracks() - 1));
+                    RealTimeLogger::log ("Removed Track: " + name);
+                }
+                return;
+            }
+
+            if (cmd == "addBus") {
+                juce::String name = params["name"];
+                const auto kind = params["kind"].toString() == "group" ? Bus::Kind::group : Bus::Kind::fxReturn;
+                mixer.addBus (name, kind);
+                RealTimeLogger::log ("Added Bus: " + name);
+                return;
+            }
+
+            // Fader and routing commands address a track, or a bus when busIndex is given
+            Track* source = params.hasProperty ("busIndex") ? static_cast<Track*> (mixer.getBus ((int) params["busIndex"]))
+                                                            : mixer.getTrack ((int) params["trackIndex"]);
+            if (source != nullptr) {
+                if (cmd == "output") {
+                    if (! mixer.setOutput (*source, (int) params["value"]))
+                        RealTimeLogger::log ("Routing rejected: " + source->getName() + " would feed back into itself");
+                    return;
+                }
+                if (cmd == "send") {
+                    if (! mixer.setSend (*source, (int) params["bus"], (float) params["value"], (bool) params["pre"]))
+                        RealTimeLogger::log ("Send rejected: " + source->getName() + " would feed back into itself");
+                    return;
+                }
+                if (cmd == "removeSend") {
+                    mixer.removeSend (*source, (int) params["bus"]);
+                    return;
+                }
+                if (cmd == "vol") { source->setVolume ((float) params["value"]); return; }
+                if (cmd == "pan") { source->setPan ((float) params["value"]); return; }
+            }
+
+            if (params.hasProperty ("busIndex")) {
+                if (auto* bus = mixer.getBus ((int) params["busIndex"]); bus != nullptr && cmd == "mute")
+                    bus->setMuted ((bool) params["value"]);
+                return;
+            }
+
             int trackIndex = params["trackIndex"];
             if (auto* track = mixer.getTrack(trackIndex)) {
                 if (cmd == "mute") {
@@ -131,11 +209,42 @@ MainComponent::MainComponent()
                     track->setSoloed(val);
                     RealTimeLogger::log(track->getName() + (val ? " Soloed" : " Unsoloed"));
                 }
-                else if (cmd == "vol") track->setVolume((float)params["value"]);
-                else if (cmd == "pan") track->setPan((float)params["value"]);
-                else if (cmd == "select") {
-                    selectedTrackIndex = trackIndex;
+                else if (auto* audio = dynamic_cast<AudioTrack*> (track); audio != nullptr && cmd == "arm") {
+                    const bool val = (bool) params["value"];
+                    audio->setArmed (val);
+                    if (! val) audio->setRecordTake (nullptr);
+                    else if (transport.getIsRecording()) startAudioTakes();
+                    RealTimeLogger::log (track->getName() + (val ? " Armed" : " Disarmed"));
+                }
+                else if (audio != nullptr && cmd == "input") {
+                    audio->setInput ((int) params["value"], 2);
+                    RealTimeLogger::log (track->getName() + " Input: " + juce::String (audio->getFirstInput() + 1) + "/" + juce::String (audio->getFirstInput() + 2));
+                }
+                else if (auto* inst = dynamic_cast<InstrumentTrack*> (track); inst != nullptr && cmd == "loadSampler") {
+                    loadSampler (trackIndex);
+                }
+                else if (inst != nullptr && cmd == "loadWavetable") {
+                    loadWavetable (trackIndex);
+                }
+                else if (inst != nullptr && cmd == "freeze") {
+                    const bool val = (bool) params["value"];
+                    inst->setFreezeEnabled (val);
+                    updateFreezes();
+                    RealTimeLogger::log (track->getName() + (val ? " Freezing" : " Unfrozen"));
+                }
+                else if (inst != nullptr && cmd == "loadSynth") {
+                    auto synth = std::make_unique<InternalSynthProcessor>();
+                    mixer.prepareProcessor (*synth);
+                    inst->setInstrument (std::move (synth));
                     updateSynthParams();
+                    RealTimeLogger::log (track->getName() + " Instrument: Internal Synth");
+                }
+                else if (cmd == "priority") {
+                    track->setVoicePriority ((int) params["value"]);
+                    RealTimeLogger::log (track->getName() + " Voice Priority: " + juce::String (track->getVoicePriority()));
+                }
+                else if (cmd == "select") {
+                    selectTrack (trackIndex);
                     RealTimeLogger::log("Selected Track: " + track->getName());
                 }
             }
@@ -152,7 +261,7 @@ MainComponent::MainComponent()
     webBrowser->goToURL (juce::WebBrowserComponent::getResourceProviderRoot());
 
     setSize (1000, 700);
-    setAudioChannels (0, 2);
+    setAudioChannels (numInputChannels, 2);
     startTimerHz (60);
 }
 
@@ -168,8 +277,13 @@ MainComponent::~MainComponent()
 void MainComponent::prepareToPlay (int samplesPerBlockExpected, double sampleRate)
 {
     currentSampleRate = sampleRate;
+    currentBlockSize = samplesPerBlockExpected;
+    liveInput.prepare (sampleRate);
+    profiler.prepare (mixer.getNumTracks(), mixer.getLayoutVersion());
     mixer.prepareToPlay (sampleRate, samplesPerBlockExpected);
     updateSynthParams();
+    RealTimeLogger::log ("Master latency: " + juce::String (mixer.getLatencySamples()) + " samples ("
+                         + juce::String (1000.0 * mixer.getLatencySamples() / sampleRate, 1) + " ms limiter lookahead)");
 }
 
 void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& bufferToFill)
@@ -180,103 +294,126 @@ void MainComponent::getNextAudioBlock (const juce::AudioSourceChannelInfo& buffe
         return;
     }
 
+    profiler.beginCallback (bufferToFill.numSamples, currentSampleRate);
+
     // 1. Advance Transport and Trigger Notes for this block
+    // The loop region once for the whole block, so the wrap, the sequencer and live input all agree
+    const auto loop = transport.getLoopRegion();
     double beatBefore = transport.getCurrentBeat();
     if (transport.getIsPlaying())
-        transport.advance (bufferToFill.numSamples, currentSampleRate);
+        transport.advance (bufferToFill.numSamples, currentSampleRate, loop);
     double beatAfter = transport.getCurrentBeat();
 
+    // Lock-free read of the latest published tracks (no copy, no allocation)
+    const Mixer::ReadScope tracksView (mixer);
+
+    for (int i = 0; i < tracksView.getNumTracks(); ++i)
+        tracksView.getTrack (i)->setPlayhead (beatBefore, transport.getIsPlaying());
+
     if (transport.getIsPlaying())
     {
-        for (int i = 0; i < mixer.getNumTracks(); ++i)
+        const ProjectModel::ReadScope notesView (model);
+        const Sequencer::BlockWindow window (beatBefore, beatAfter, transport, loop, bufferToFill.numSamples, currentSampleRate);
+
+        for (int i = 0; i < tracksView.getNumTracks(); ++i)
         {
-            if (auto* track = mixer.getTrack(i))
-            {
-                if (auto* inst = dynamic_cast<InstrumentTrack*>(track))
-                {
-                    if (auto* synth = dynamic_cast<InternalSynthProcessor*>(inst->getProcessor()))
-                    {
-                        const auto& notes = model.getNotes(i);
-                        for (const auto& note : notes)
-                        {
-                            bool noteStarted = (note.startBeat >= beatBefore && note.startBeat < beatAfter);
-                            if (beatAfter < beatBefore) noteStarted = (note.startBeat >= beatBefore || note.startBeat < beatAfter);
-                            if (noteStarted) synth->noteOn (note.note, note.velocity);
-
-                            double endBeat = note.startBeat + note.durationBeats;
-                            if (endBeat >= 16.0) endBeat -= 16.0;
-                            bool noteEnded = (endBeat >= beatBefore && endBeat < beatAfter);
-                            if (beatAfter < beatBefore) noteEnded = (endBeat >= beatBefore || endBeat < beatAfter);
-                            if (noteEnded) synth->noteOff (note.note, 0.0f, true);
-                        }
-                    }
-                }
-            }
+            const auto* trackNotes = notesView.getTrack(i);
+            auto* track = tracksView.getTrack(i);
+            if (trackNotes != nullptr && track != nullptr)
+                Sequencer::scheduleTrack (*trackNotes, window, track->getScheduledMidi());
         }
     }
 
-    // 2. Process Mixer (Master Sum) - Mixer handles clearing the buffer
+    // 2. Armed tracks take their input before the mixer overwrites the buffer
+    for (int i = 0; i < tracksView.getNumTracks(); ++i)
+        if (auto* take = tracksView.getTrack (i)->getRecordTake())
+            take->write (*bufferToFill.buffer, bufferToFill.startSample, bufferToFill.numSamples);
+
+    // 3. Live input plays on the selected track, each event where it arrived in the last callback period
+    {
+        const int liveTrack = liveTrackIndex.load (std::memory_order_relaxed);
+        auto* track = tracksView.getTrack (liveTrack);
+        const bool playing = transport.getIsPlaying(), recording = playing && transport.getIsRecording();
+        const double beatsPerSample = transport.getBeatsPerSample (currentSampleRate);
+
+        liveInput.drain (bufferToFill.numSamples, [&] (const LiveMidiInput::Event& e, int offset) {
+            if (track != nullptr)
+                track->getScheduledMidi().addEvent (e.data, e.size, offset);
+
+            if (! e.isNoteOn() && ! e.isNoteOff()) return;
+
+            double beat = beatBefore;
+            if (playing) {
+                beat += offset * beatsPerSample;
+                if (beatAfter < beatBefore && beat >= loop.end) // Wrapped within this block
+                    beat -= loop.getLength();
+            }
+            liveInput.report ({ liveTrack, e.data[1], e.isNoteOn() ? e.data[2] / 127.0f : 0.0f, beat, recording, e.fromDevice });
+        });
+    }
+
+    // 4. Process Mixer (Master Sum) - Mixer handles clearing the buffer
     juce::MidiBuffer midiMessages;
     mixer.processBlock (*bufferToFill.buffer, midiMessages);
 
-    // 3. Post-Mixer Overlays (Metronome)
+    // 5. Post-Mixer Overlays (Metronome)
     if (metronomeEnabled && transport.getIsPlaying())
     {
         if (std::floor(beatAfter) != std::floor(beatBefore) || (beatBefore > beatAfter))
             playMetronomeClick(bufferToFill);
     }
+
+    profiler.endCallback();
 }
 
 void MainComponent::handleIncomingMidiMessage (juce::MidiInput*, const juce::MidiMessage& message)
 {
-    postMidiToEngine(message);
-    
-    juce::MessageManager::callAsync ([this, message]() {
-        if (message.isNoteOn() || message.isNoteOff())
-        {
-            juce::DynamicObject::Ptr obj = new juce::DynamicObject();
-            obj->setProperty ("note", message.getNoteNumber());
-            obj->setProperty ("velocity", message.isNoteOn() ? message.getFloatVelocity() : 0.0f);
-            webBrowser->evaluateJavascript ("if(window.onMidiIn) window.onMidiIn(" + juce::JSON::toString(juce::var(obj.get())) + ");");
-        }
-    });
+    liveInput.post (message, true); // Everything else happens on the audio and message threads
 }
 
-void MainComponent::postMidiToEngine (const juce::MidiMessage& message)
+// Message Thread, once per frame: commits finished recorded notes, one batch per track, and lights the played keys
+void MainComponent::drainLiveInput()
 {
-    // MIDI RECORDING LOGIC
-    if (transport.getIsRecording()) {
-        if (message.isNoteOn()) {
-            activeRecordingNotes[message.getNoteNumber()] = { transport.getCurrentBeat(), message.getFloatVelocity() };
-        } else if (message.isNoteOff() || (message.isNoteOn() && message.getVelocity() == 0)) {
-            int n = message.getNoteNumber();
-            if (activeRecordingNotes.count(n)) {
-                double start = activeRecordingNotes[n].startBeat;
-                float vel = activeRecordingNotes[n].velocity;
-                double end = transport.getCurrentBeat();
-                
-                if (end < start) end += 16.0; // Loop wrap
-                
-                double duration = end - start;
-                if (duration < 0.05) duration = 0.1;
-
-                model.addNote(selectedTrackIndex, { n, vel, start, duration });
-                activeRecordingNotes.erase(n);
-                
-                RealTimeLogger::log("Track " + juce::String(selectedTrackIndex + 1) + " Captured: " + juce::String(n) + " @ beat " + juce::String(start, 2));
-            }
+    std::map<int, NoteEditBatch> captured;
+    juce::Array<juce::var> keys;
+
+    LiveMidiInput::PlayedNote played;
+    while (liveInput.nextPlayedNote (played))
+    {
+        if (played.fromDevice) {
+            juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+            obj->setProperty ("note", played.note);
+            obj->setProperty ("velocity", played.velocity);
+            keys.add (juce::var (obj.get()));
         }
-    }
 
-    // Live Monitoring
-    if (auto* track = mixer.getTrack(selectedTrackIndex)) {
-        if (auto* inst = dynamic_cast<InstrumentTrack*>(track)) {
-            if (auto* synth = dynamic_cast<InternalSynthProcessor*>(inst->getProcessor())) {
-                if (message.isNoteOn()) synth->noteOn(message.getNoteNumber(), message.getFloatVelocity());
-                else if (message.isNoteOff()) synth->noteOff(message.getNoteNumber(), message.getFloatVelocity(), true);
-            }
+        if (played.velocity > 0.0f) {
+            if (played.recorded)
+                activeRecordingNotes[played.note] = { played.beat, played.velocity, played.track };
+            continue;
         }
+
+        auto held = activeRecordingNotes.find (played.note);
+        if (held == activeRecordingNotes.end()) continue;
+
+        const double start = held->second.startBeat;
+        double end = played.beat;
+        if (end < start) end += transport.getLoopLength(); // Loop wrap
+
+        double duration = end - start;
+        if (duration < 0.05) duration = 0.1;
+
+        captured[held->second.track].add ({ played.note, held->second.velocity, start, duration });
+        activeRecordingNotes.erase (held);
+    }
+
+    for (auto& [track, batch] : captured) {
+        model.applyEdits (track, batch);
+        RealTimeLogger::log ("Track " + juce::String (track + 1) + " Captured notes");
     }
+
+    if (! keys.isEmpty())
+        webBrowser->evaluateJavascript ("if(window.onMidiIn) " + juce::JSON::toString (juce::var (keys)) + ".forEach(m => window.onMidiIn(m));");
 }
 
 void MainComponent::playMetronomeClick (const juce::AudioSourceChannelInfo& bufferToFill)
@@ -296,6 +433,187 @@ void MainComponent::playMetronomeClick (const juce::AudioSourceChannelInfo& buff
     }
 }
 
+// Message Thread: one take per armed audio track that is not already recording
+void MainComponent::startAudioTakes()
+{
+    auto folder = juce::File ("C:\\music_maker\\Recordings");
+    folder.createDirectory();
+    const auto stamp = juce::Time::getCurrentTime().formatted ("%Y%m%d_%H%M%S");
+
+    for (int i = 0; i < mixer.getNumTracks(); ++i) {
+        auto* audio = dynamic_cast<AudioTrack*> (mixer.getTrack (i));
+        if (audio == nullptr || ! audio->getIsArmed() || audio->isRecording()) continue;
+
+        const auto file = folder.getChildFile (juce::File::createLegalFileName (audio->getName()) + "_" + stamp + ".wav");
+        if (auto take = recorder.startTake (file, audio->getFirstInput(), audio->getNumInputs(), currentSampleRate)) {
+            audio->setRecordTake (take);
+            runningTakes.push_back (std::move (take));
+            RealTimeLogger::log ("Recording " + audio->getName() + " to " + file.getFullPathName());
+        } else {
+            RealTimeLogger::log ("Could not record to " + file.getFullPathName());
+        }
+    }
+}
+
+void MainComponent::stopAudioTakes()
+{
+    for (int i = 0; i < mixer.getNumTracks(); ++i)
+        if (auto* audio = dynamic_cast<AudioTrack*> (mixer.getTrack (i)))
+            audio->setRecordTake (nullptr);
+}
+
+// Message Thread: replaces the track's instrument with a sampler built from a mapping file
+void MainComponent::loadSampler (int trackIndex)
+{
+    if (lastDirectory.getFullPathName().isEmpty())
+        lastDirectory = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory);
+
+    fileChooser = std::make_unique<juce::FileChooser> ("Load Sampler Mapping", lastDirectory, "*.json");
+    fileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles, [this, trackIndex, layout = mixer.getLayoutVersion()] (const juce::FileChooser& fc) {
+        auto file = fc.getResult();
+        if (! file.existsAsFile()) return;
+        lastDirectory = file.getParentDirectory();
+
+        // Tracks may have been removed while the chooser was open, and the index be another track's now
+        if (mixer.getLayoutVersion() != layout) {
+            RealTimeLogger::log ("Tracks changed while choosing a file; nothing loaded");
+            return;
+        }
+        auto* track = dynamic_cast<InstrumentTrack*> (mixer.getTrack (trackIndex));
+        if (track == nullptr) return;
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        juce::String error;
+        auto sampler = SamplerProcessor::loadMapping (file, samplePool, error);
+        if (sampler == nullptr) {
+            RealTimeLogger::log ("Sampler not loaded: " + error);
+            return;
+        }
+
+        const auto zones = sampler->getNumZones();
+        const auto name = sampler->getName();
+        mixer.prepareProcessor (*sampler);
+        track->setInstrument (std::move (sampler));
+
+        const auto stats = samplePool.getStats();
+        const auto ms = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+        RealTimeLogger::log (track->getName() + " Instrument: " + name + " (" + juce::String (zones) + " zones, "
+                             + juce::String (ms, 1) + " ms; pool " + juce::String (stats.numSamples) + " samples, "
+                             + juce::String ((double) stats.memoryUsed / (1 << 20), 1) + " MB)");
+    });
+}
+
+// Message Thread: gives the track an internal synth playing a user wavetable from a WAV file
+void MainComponent::loadWavetable (int trackIndex)
+{
+    if (lastDirectory.getFullPathName().isEmpty())
+        lastDirectory = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory);
+
+    fileChooser = std::make_unique<juce::FileChooser> ("Load Wavetable", lastDirectory, "*.wav");
+    fileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles, [this, trackIndex, layout = mixer.getLayoutVersion()] (const juce::FileChooser& fc) {
+        auto file = fc.getResult();
+        if (! file.existsAsFile()) return;
+        lastDirectory = file.getParentDirectory();
+
+        // Tracks may have been removed while the chooser was open, and the index be another track's now
+        if (mixer.getLayoutVersion() != layout) {
+            RealTimeLogger::log ("Tracks changed while choosing a file; nothing loaded");
+            return;
+        }
+        auto* track = dynamic_cast<InstrumentTrack*> (mixer.getTrack (trackIndex));
+        if (track == nullptr) return;
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        juce::String error;
+        auto table = wavetables.load (file, error);
+        if (table == nullptr) {
+            RealTimeLogger::log ("Wavetable not loaded: " + error);
+            return;
+        }
+
+        const auto oscType = (int) Waveform::wavetable;
+        auto synth = std::make_unique<InternalSynthProcessor>();
+        synth->setWavetable (table);
+        synth->updateParameters (oscType, track->getCutoff(), track->getResonance());
+        mixer.prepareProcessor (*synth);
+        track->setInstrument (std::move (synth));
+        track->setParams (oscType, track->getCutoff(), track->getResonance());
+
+        const auto ms = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+        RealTimeLogger::log (track->getName() + " Wavetable: " + table->getName() + " (" + juce::String (ms, 1) + " ms)");
+    });
+}
+
+// Message Thread: keeps every track that asked to be frozen playing a render of its current notes
+// and sound. A freeze that went out of date is dropped at once, so the live instrument plays until
+// the new one is in.
+void MainComponent::updateFreezes()
+{
+    if (currentSampleRate <= 0.0) return;
+
+    for (int i = 0; i < mixer.getNumTracks(); ++i) {
+        auto* inst = dynamic_cast<InstrumentTrack*> (mixer.getTrack (i));
+        if (inst == nullptr || ! inst->isFreezeEnabled()) continue;
+
+        uint64_t notesVersion = 0;
+        auto notes = model.getTrackNotes (i, notesVersion);
+        const FrozenAudio::Source source { notesVersion, inst->getInstrumentVersion(), transport.getStateVersion(), currentSampleRate };
+
+        if (auto* frozen = inst->getFrozenAudio(); frozen != nullptr && ! (frozen->source == source)) {
+            inst->setFrozenAudio (nullptr);
+            RealTimeLogger::log (inst->getName() + " Freeze out of date, re-rendering");
+        }
+
+        auto& job = inst->getFreezeJob();
+        if (job != nullptr && job->isFinished()) {
+            auto audio = job->takeResult();
+            if (audio != nullptr && audio->source == source) {
+                RealTimeLogger::log (inst->getName() + " Frozen: " + juce::String (audio->loopSamples / currentSampleRate, 1) + " s loop rendered in "
+                                     + juce::String (job->getRenderSeconds() * 1000.0, 0) + " ms");
+                inst->setFrozenAudio (std::move (audio));
+            }
+            job.reset();
+        }
+
+        if (job != nullptr && ! (job->getSource() == source)) {
+            job->cancel();
+            job.reset();
+        }
+
+        if (job == nullptr && inst->getFrozenAudio() == nullptr) {
+            auto instrument = inst->createOfflineInstrument();
+            if (instrument == nullptr) {
+                inst->setFreezeEnabled (false);
+                RealTimeLogger::log (inst->getName() + " cannot be frozen: its instrument cannot be copied");
+                continue;
+            }
+            job = freezer.start (std::move (instrument), std::move (notes), transport, source, currentBlockSize);
+        }
+    }
+}
+
+// Message Thread: logs takes whose files the recorder has closed
+void MainComponent::reportFinishedTakes()
+{
+    for (auto it = runningTakes.begin(); it != runningTakes.end();) {
+        auto& take = **it;
+        if (! take.isFinished()) { ++it; continue; }
+
+        const auto seconds = currentSampleRate > 0 ? take.getNumSamplesWritten() / currentSampleRate : 0.0;
+        RealTimeLogger::log ((take.hasFailed() ? "Recording incomplete (disk error): " : "Recorded ") + take.getFile().getFullPathName()
+                             + " (" + juce::String (seconds, 1) + " s, " + juce::String ((juce::int64) take.getNumDroppedBlocks()) + " dropped blocks)");
+        it = runningTakes.erase (it);
+    }
+}
+
+// Message Thread: the track the editor shows and live input plays
+void MainComponent::selectTrack (int index)
+{
+    selectedTrackIndex = juce::jmax (0, index);
+    liveTrackIndex.store (selectedTrackIndex);
+    updateSynthParams();
+}
+
 void MainComponent::updateSynthParams()
 {
     if (auto* track = mixer.getTrack(selectedTrackIndex)) {
@@ -312,73 +630,81 @@ void MainComponent::saveProject()
     if (lastDirectory.getFullPathName().isEmpty())
         lastDirectory = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory);
 
-    fileChooser = std::make_unique<juce::FileChooser> ("Save Project", lastDirectory, "*.json");
+    fileChooser = std::make_unique<juce::FileChooser> ("Save Project", lastDirectory, "*.mmproj;*.json");
     fileChooser->launchAsync (juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles, [this] (const juce::FileChooser& fc) {
         auto file = fc.getResult();
-        if (file.getFullPathName().isNotEmpty()) {
-            model.saveToFile (file);
-            lastDirectory = file.getParentDirectory();
-            RealTimeLogger::log ("Project saved to: " + file.getFullPathName());
+        if (file.getFullPathName().isEmpty()) return;
+
+        // .json stays available for the AI bridge; anything else is saved as the binary container
+        bool saved = false;
+        if (file.hasFileExtension ("json")) {
+            saved = file.replaceWithText (getFullProjectJson());
+        } else {
+            if (! file.hasFileExtension ("mmproj")) file = file.withFileExtension ("mmproj");
+            saved = ProjectBinary::write (file, model, transport, mixer);
         }
+
+        lastDirectory = file.getParentDirectory();
+        RealTimeLogger::log (saved ? "Project saved to: " + file.getFullPathName() : "Could not save: " + file.getFullPathName());
     });
 }
 
-juce::String MainComponent::getFullProjectJson()
+void MainComponent::openProject()
 {
-    juce::DynamicObject::Ptr obj = new juce::DynamicObject();
-    obj->setProperty("bpm", transport.getBpm());
-    
-    for (int i = 0; i < mixer.getNumTracks(); ++i) {
-        juce::DynamicObject::Ptr tData = new juce::DynamicObject();
-        tData->setProperty("notes", model.toMinifiedVar(i));
-        
-        if (auto* track = mixer.getTrack(i)) {
-            if (auto* inst = dynamic_cast<InstrumentTrack*>(track)) {
-                tData->setProperty("osc", inst->getOscType());
-                tData->setProperty("cut", inst->getCutoff());
-                tData->setProperty("res", inst->getResonance());
+    if (lastDirectory.getFullPathName().isEmpty())
+        lastDirectory = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory);
+
+    fileChooser = std::make_unique<juce::FileChooser> ("Open Project", lastDirectory, "*.mmproj;*.json");
+    fileChooser->launchAsync (juce::FileBrowserComponent::openMode | juce::FileBrowserComponent::canSelectFiles, [this] (const juce::FileChooser& fc) {
+        auto file = fc.getResult();
+        if (! file.existsAsFile()) return;
+        lastDirectory = file.getParentDirectory();
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        bool loaded = false;
+
+        if (ProjectBinary::isBinaryProject (file)) {
+            ProjectBinary::Reader reader (file);
+            if (reader.isValid()) {
+                addTracksUpTo (reader.getNumTracks());
+                loaded = reader.load (model, transport, mixer);
             }
+        } else {
+            auto project = juce::JSON::parse (file.loadFileAsString());
+            addTracksUpTo (ProjectJson::getNumTracks (project));
+            loaded = ProjectJson::load (project, model, transport, mixer);
+        }
+
+        if (! loaded) {
+            RealTimeLogger::log ("Not a valid project: " + file.getFullPathName());
+            return;
         }
-        
-        obj->setProperty("t" + juce::String(i + 1), juce::var(tData.get()));
+
+        model.clearHistory(); // A freshly opened project starts with an empty history
+        updateSynthParams();
+        const auto ms = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks) * 1000.0;
+        RealTimeLogger::log ("Project opened in " + juce::String (ms, 1) + " ms: " + file.getFullPathName());
+    });
+}
+
+// Message Thread: the project decides how many tracks there are, existing ones are kept
+void MainComponent::addTracksUpTo (int numTracks)
+{
+    for (int i = mixer.getNumTracks(); i < numTracks; ++i) {
+        auto t = std::make_unique<InstrumentTrack> ("Track " + juce::String (i + 1));
+        t->setInstrument (std::make_unique<InternalSynthProcessor>());
+        mixer.addTrack (std::move (t));
     }
-    
-    return juce::JSON::toString(juce::var(obj.get()));
+}
+
+juce::String MainComponent::getFullProjectJson()
+{
+    return ProjectJson::toJson (model, transport, mixer);
 }
 
 void MainComponent::loadFullProjectJson(const juce::String& json)
 {
-    auto var = juce::JSON::parse(json);
-    if (var.isObject()) {
-        if (var.hasProperty("bpm")) transport.setBpm(var["bpm"]);
-        
-        model.clear();
-        if (auto* dynObj = var.getDynamicObject())
-        {
-            auto& props = dynObj->getProperties();
-            for (int i = 1; i <= 32; ++i) { 
-                juce::String trackKey = "t" + juce::String(i);
-                if (props.contains(trackKey)) {
-                    auto tVar = props[trackKey];
-                    if (tVar.isObject()) {
-                        model.fromMinifiedVar(i - 1, tVar["notes"]);
-                        
-                        if (auto* track = mixer.getTrack(i - 1)) {
-                            if (auto* inst = dynamic_cast<InstrumentTrack*>(track)) {
-                                int osc = tVar.hasProperty("osc") ? (int)tVar["osc"] : 1;
-                                float cut = tVar.hasProperty("cut") ? (float)tVar["cut"] : 2000.0f;
-                                float res = tVar.hasProperty("res") ? (float)tVar["res"] : 0.7f;
-                                inst->setParams(osc, cut, res);
-                            }
-                        }
-                    } else {
-                        // Legacy support for plain note arrays
-                        model.fromMinifiedVar(i - 1, tVar);
-                    }
-                }
-            }
-        }
-        
+    if (ProjectJson::load (juce::JSON::parse(json), model, transport, mixer)) {
         updateSynthParams();
         RealTimeLogger::log("Project Loaded via JSON");
     }
@@ -455,7 +781,7 @@ void MainComponent::loadAudioSettings()
         auto xml = juce::XmlDocument::parse(file);
         if (xml != nullptr)
         {
-            auto err = deviceManager.initialise(0, 2, xml.get(), true);
+            auto err = deviceManager.initialise(numInputChannels, 2, xml.get(), true);
             if (err.isEmpty())
             {
                 RealTimeLogger::log("Audio settings loaded from file.");
@@ -467,7 +793,7 @@ void MainComponent::loadAudioSettings()
     
     // Fallback if no file or error: explicitly scan types
     RealTimeLogger::log("No valid audio settings file found. Using defaults.");
-    deviceManager.initialiseWithDefaultDevices(0, 2);
+    deviceManager.initialiseWithDefaultDevices(numInputChannels, 2);
     
     // Ensure the device types are available immediately
     auto& types = deviceManager.getAvailableDeviceTypes();
@@ -478,42 +804,11 @@ void MainComponent::loadAudioSettings()
 
 void MainComponent::timerCallback()
 {
-    juce::DynamicObject::Ptr obj = new juce::DynamicObject();
-    obj->setProperty ("beat", transport.getCurrentBeat());
-    obj->setProperty ("playing", transport.getIsPlaying());
-    
-    juce::Array<juce::var> notesArray;
-    for (const auto& n : model.getNotes(selectedTrackIndex)) {
-        juce::DynamicObject::Ptr nObj = new juce::DynamicObject();
-        nObj->setProperty("n", n.note); 
-        nObj->setProperty("s", n.startBeat); 
-        nObj->setProperty("d", n.durationBeats);
-        notesArray.add(juce::var(nObj.get()));
-    }
-    obj->setProperty("notes", notesArray);
-    obj->setProperty("selectedTrack", selectedTrackIndex);
-
-    juce::Array<juce::var> tracksArray;
-    int nTracks = mixer.getNumTracks();
-    for (int i = 0; i < nTracks; ++i) {
-        if (auto* t = mixer.getTrack(i)) {
-            juce::DynamicObject::Ptr tObj = new juce::DynamicObject();
-            tObj->setProperty("name", t->getName());
-            tObj->setProperty("vol", t->getVolume());
-            tObj->setProperty("pan", t->getPan());
-            tObj->setProperty("mute", t->getIsMuted());
-            tObj->setProperty("solo", t->getIsSoloed());
-
-            if (auto* inst = dynamic_cast<InstrumentTrack*>(t)) {
-                tObj->setProperty("osc", inst->getOscType());
-                tObj->setProperty("cutoff", inst->getCutoff());
-                tObj->setProperty("res", inst->getResonance());
-            }
-
-            tracksArray.add(juce::var(tObj.get()));
-        }
-    }
-    obj->setProperty("tracks", tracksArray);
+    model.collectGarbage();
+    mixer.collectGarbage();
+    drainLiveInput();
+    reportFinishedTakes();
+    updateFreezes();
 
     auto logs = RealTimeLogger::getPendingUiLogs();
     
@@ -524,13 +819,92 @@ void MainComponent::timerCallback()
             RealTimeLogger::log("REC RUNNING: beat " + juce::String(transport.getCurrentBeat(), 1));
     }
 
+    const bool profileDue = ++ticksSinceProfile >= profileInterval;
+    if (profileDue)
+    {
+        ticksSinceProfile = 0;
+        profiler.collect (mixer.getNumTracks(), mixer.getLayoutVersion());
+
+        const auto late = profiler.getNumLateCallbacks(), overruns = profiler.getNumOverruns();
+        if (late != loggedLateCallbacks || overruns != loggedOverruns)
+            RealTimeLogger::log ("Audio: " + juce::String ((juce::int64) (late - loggedLateCallbacks)) + " late callbacks, "
+                                 + juce::String ((juce::int64) (overruns - loggedOverruns)) + " overruns");
+        loggedLateCallbacks = late;
+        loggedOverruns = overruns;
+
+        const auto midiDrops = liveInput.getNumDropped();
+        if (midiDrops != loggedMidiDrops)
+            RealTimeLogger::log ("MIDI: " + juce::String ((juce::int64) (midiDrops - loggedMidiDrops)) + " live events dropped");
+        loggedMidiDrops = midiDrops;
+
+        const auto recorderDrops = recorder.getCounters().droppedBlocks;
+        if (recorderDrops != loggedRecorderDrops)
+            RealTimeLogger::log ("Recording: " + juce::String ((juce::int64) (recorderDrops - loggedRecorderDrops)) + " input blocks dropped (disk too slow)");
+        loggedRecorderDrops = recorderDrops;
+
+        const auto underruns = samplePool.getStats().underruns;
+        if (underruns != loggedUnderruns)
+            RealTimeLogger::log ("Sampler: " + juce::String ((juce::int64) (underruns - loggedUnderruns)) + " stream underruns (disk too slow)");
+        loggedUnderruns = underruns;
+    }
+
+    auto update = uiSync.buildUpdate (model, transport, mixer, selectedTrackIndex, logs.size() > 0 || profileDue);
+    if (! update.isObject()) return; // Nothing changed, nothing to send
+
+    if (profileDue)
+    {
+        auto profile = profiler.toVar (mixer.getNumTracks());
+        profile.getDynamicObject()->setProperty ("xruns", deviceManager.getXRunCount());
+
+        const auto voices = mixer.getVoiceCounters();
+        juce::DynamicObject::Ptr voicesObj = new juce::DynamicObject();
+        voicesObj->setProperty ("active", voices.active);
+        voicesObj->setProperty ("budget", voices.budget);
+        voicesObj->setProperty ("stolen", (juce::int64) voices.stolen);
+        voicesObj->setProperty ("dropped", (juce::int64) voices.dropped);
+        profile.getDynamicObject()->setProperty ("voices", juce::var (voicesObj.get()));
+        profile.getDynamicObject()->setProperty ("idleTracks", mixer.getNumIdleTracks());
+        profile.getDynamicObject()->setProperty ("limiterDb", mixer.getLimiter().takeGainReductionDb());
+
+        const auto rec = recorder.getCounters();
+        juce::DynamicObject::Ptr recObj = new juce::DynamicObject();
+        recObj->setProperty ("takes", rec.activeTakes);
+        recObj->setProperty ("highWater", rec.highWater * 100.0f);
+        recObj->setProperty ("dropped", (juce::int64) rec.droppedBlocks);
+        profile.getDynamicObject()->setProperty ("recorder", juce::var (recObj.get()));
+
+        const auto pool = samplePool.getStats();
+        juce::DynamicObject::Ptr poolObj = new juce::DynamicObject();
+        poolObj->setProperty ("samples", pool.numSamples);
+        poolObj->setProperty ("memoryMb", (double) pool.memoryUsed / (1 << 20));
+        poolObj->setProperty ("underruns", (juce::int64) pool.underruns);
+        profile.getDynamicObject()->setProperty ("sampler", juce::var (poolObj.get()));
+        update.getDynamicObject()->setProperty ("profile", profile);
+    }
+
     if (logs.size() > 0) {
         juce::Array<juce::var> logsVar;
         for (auto& l : logs) logsVar.add (l);
-        obj->setProperty ("logs", logsVar);
+        update.getDynamicObject()->setProperty ("logs", logsVar);
     }
 
-    webBrowser->evaluateJavascript ("if(window.onUpdate) window.onUpdate(" + juce::JSON::toString(juce::var(obj.get())) + ");");
+    webBrowser->evaluateJavascript ("if(window.onUpdate) window.onUpdate(" + juce::JSON::toString(update) + ");");
+}
+
+void MainComponent::dumpProfile()
+{
+    profiler.collect (mixer.getNumTracks(), mixer.getLayoutVersion());
+
+    juce::StringArray trackNames;
+    for (int i = 0; i < mixer.getNumTracks(); ++i)
+        if (auto* track = mixer.getTrack (i))
+            trackNames.add (track->getName());
+
+    auto file = juce::File ("C:\\music_maker\\profile_" + juce::Time::getCurrentTime().formatted ("%Y%m%d_%H%M%S") + ".txt");
+    if (profiler.writeReport (file, trackNames, deviceManager.getXRunCount()))
+        RealTimeLogger::log ("Profile written to " + file.getFullPathName());
+    else
+        RealTimeLogger::log ("Failed to write profile to " + file.getFullPathName());
 }
 
 void MainComponent::releaseResources() 
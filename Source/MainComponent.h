@@ -5,6 +5,12 @@
 #include "SynthEngine.h"
 #include "Mixer.h"
 #include "InternalSynth.h"
+#include "UiStateSync.h"
+#include "CallbackProfiler.h"
+#include "LiveMidiInput.h"
+#include "AudioTrack.h"
+#include "DiskRecorder.h"
+#include "SamplePool.h"
 
 class MainComponent  : public juce::AudioAppComponent, 
                         public juce::MidiInputCallback,
@@ -29,29 +35,67 @@ public:
 
 private:
     std::unique_ptr<juce::WebBrowserComponent> webBrowser;
+
+    // Samples for every sampler instrument; declared first so it outlives the tracks using it
+    SamplePool samplePool;
+    uint64_t loggedUnderruns = 0;
+
+    // User wavetables, one set of tables per file however many synths play it
+    WavetableLibrary wavetables;
+
+    // Renders frozen tracks; its jobs may hold sampler copies, so it goes before the pool
+    TrackFreezer freezer;
     
     // Multi-track Mixer
     Mixer mixer;
     int selectedTrackIndex = 0;
+    std::atomic<int> liveTrackIndex { 0 }; // selectedTrackIndex, for the audio thread
     
     // Sequencing
     Transport transport;
     ProjectModel model;
+    UiStateSync uiSync; // Sends the WebView only what changed since the last tick
+
+    // Callback and per-track timing, sent with every profileInterval-th UI update
+    CallbackProfiler profiler;
+    static constexpr int profileInterval = 15;
+    int ticksSinceProfile = 0;
+    uint64_t loggedLateCallbacks = 0, loggedOverruns = 0, loggedMidiDrops = 0;
     double lastProcessedBeat = -1.0;
     double currentSampleRate = 0.0;
+    int currentBlockSize = 0;
     
-    // Recording state (Professional Logic)
-    struct RecordedNote { double startBeat; float velocity; };
-    std::map<int, RecordedNote> activeRecordingNotes; // noteNumber -> {startBeat, velocity}
+    // Live input: devices and the on-screen keyboard -> audio thread -> recording and UI
+    LiveMidiInput liveInput;
+
+    // Recording state (Professional Logic), message thread only
+    struct RecordedNote { double startBeat; float velocity; int track; };
+    std::map<int, RecordedNote> activeRecordingNotes; // noteNumber -> {startBeat, velocity, track}
+
+    // Audio recording: armed audio tracks stream their inputs to disk while the transport records
+    static constexpr int numInputChannels = 8; // Asked of the device; it may open fewer
+    DiskRecorder recorder;
+    std::vector<std::shared_ptr<RecordTake>> runningTakes; // Kept until their files are closed, to report them
+    uint64_t loggedRecorderDrops = 0;
 
     // Metronome
     bool metronomeEnabled = false;
     double lastClickBeat = -1.0;
 
     void updateSynthParams();
-    void postMidiToEngine (const juce::MidiMessage& message);
+    void selectTrack (int index);
+    void drainLiveInput();
+    void startAudioTakes();
+    void stopAudioTakes();
+    void reportFinishedTakes();
+    void loadSampler (int trackIndex);
+    void loadWavetable (int trackIndex);
+    void updateFreezes();
     void playMetronomeClick (const juce::AudioSourceChannelInfo& bufferToFill);
     void saveProject();
+    void openProject();
+    void addTracksUpTo (int numTracks);
+    void dumpProfile();
     
     juce::String getFullProjectJson();
     void loadFullProjectJson (const juce::String& json);
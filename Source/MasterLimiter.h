@@ -0,0 +1,191 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+// Lookahead brickwall limiter for the master. The output is the input delayed by the lookahead,
+// times a gain that has already come down by the time a peak arrives, so nothing passes the
+// ceiling and nothing is clipped.
+//
+// The gain each sample needs (ceiling / peak across channels) goes through three O(1) stages:
+//   hold     sliding minimum over the lookahead window, a monotonic deque
+//   release  rises back towards the hold with a one-pole; drops are immediate
+//   attack   moving average over the same window, so the gain ramps down instead of stepping
+// Every value the average sees while a sample waits in the delay is at most that sample's
+// needed gain, so the average is too. Peak detection, the delay and the gain multiply work on
+// whole chunks with FloatVectorOperations; only the three stages run per sample, and their cost
+// does not depend on the lookahead.
+class MasterLimiter
+{
+public:
+    static constexpr int maxChannels = 2;
+    static constexpr double maxLookaheadMs = 20.0;
+
+    // Message Thread: applied on the next prepare(), since it changes the latency
+    void setLookahead (double milliseconds) { lookaheadMs = juce::jlimit (0.0, maxLookaheadMs, milliseconds); }
+
+    // Any thread
+    void setRelease (double milliseconds) { releaseMs.store (juce::jlimit (1.0, 2000.0, milliseconds)); }
+    void setCeiling (float decibels) { ceiling.store (juce::Decibels::decibelsToGain (juce::jlimit (-24.0f, 0.0f, decibels))); }
+
+    // Message Thread, with the audio stopped
+    void prepare (double newSampleRate, int numChannels)
+    {
+        sampleRate = newSampleRate;
+        channels = juce::jlimit (1, maxChannels, numChannels);
+        window = juce::jmax (1, (int) std::lround (lookaheadMs * 0.001 * sampleRate));
+        latency.store (window - 1);
+
+        holdValues.assign ((size_t) window, 0.0f);
+        holdIndices.assign ((size_t) window, 0);
+        attackValues.assign ((size_t) window, 1.0f);
+
+        // Room for one chunk on top of the delay, so a chunk is written before its delayed part is read
+        delaySize = window - 1 + chunkSize;
+        for (auto& line : delayLines)
+            line.assign ((size_t) delaySize, 0.0f);
+
+        reset();
+    }
+
+    void reset()
+    {
+        holdHead = holdSize = 0;
+        sampleIndex = 0;
+        release = 1.0f;
+        std::fill (attackValues.begin(), attackValues.end(), 1.0f);
+        attackSum = (double) window;
+        attackPos = 0;
+        delayPos = 0;
+        for (auto& line : delayLines)
+            std::fill (line.begin(), line.end(), 0.0f);
+        minGain.store (1.0f);
+    }
+
+    // Samples between a sample going in and coming out
+    int getLatencySamples() const { return latency.load(); }
+
+    // Message Thread: the deepest reduction since the last call, in dB (0 when idle)
+    float takeGainReductionDb()
+    {
+        return juce::Decibels::gainToDecibels (minGain.exchange (1.0f), -96.0f);
+    }
+
+    // Audio Thread. Channels beyond those prepared are cleared.
+    void process (juce::AudioBuffer<float>& buffer, int numSamples)
+    {
+        const int numChannels = juce::jmin (channels, buffer.getNumChannels());
+        for (int channel = numChannels; channel < buffer.getNumChannels(); ++channel)
+            buffer.clear (channel, 0, numSamples);
+        if (numChannels == 0) return;
+
+        const float limit = ceiling.load (std::memory_order_relaxed);
+        const float releaseCoeff = 1.0f - (float) std::exp (-1000.0 / (releaseMs.load (std::memory_order_relaxed) * sampleRate));
+        float blockMinGain = 1.0f;
+
+        for (int start = 0; start < numSamples; start += chunkSize)
+        {
+            const int n = juce::jmin (chunkSize, numSamples - start);
+
+            // Peak across channels, floored at the ceiling so the needed gain never exceeds 1
+            juce::FloatVectorOperations::abs (gains, buffer.getReadPointer (0, start), n);
+            for (int channel = 1; channel < numChannels; ++channel)
+            {
+                juce::FloatVectorOperations::abs (peaks, buffer.getReadPointer (channel, start), n);
+                juce::FloatVectorOperations::max (gains, gains, peaks, n);
+            }
+            juce::FloatVectorOperations::max (gains, gains, limit, n);
+            for (int i = 0; i < n; ++i)
+                gains[i] = limit / gains[i];
+
+            for (int i = 0; i < n; ++i)
+                gains[i] = smoothGain (gains[i], releaseCoeff);
+
+            blockMinGain = juce::jmin (blockMinGain, juce::FloatVectorOperations::findMinimum (gains, n));
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                delayAndApply (delayLines[(size_t) channel].data(), buffer.getWritePointer (channel, start), n);
+
+            delayPos = (delayPos + n) % delaySize;
+        }
+
+        if (blockMinGain < minGain.load (std::memory_order_relaxed))
+            minGain.store (blockMinGain, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int chunkSize = 128;
+
+    // Hold, release and attack for one sample's needed gain; returns the gain for the sample leaving the delay
+    float smoothGain (float needed, float releaseCoeff)
+    {
+        // Hold: the deque keeps increasing values, so its front is the window minimum.
+        // One sample arrives per call, so at most one leaves.
+        if (holdSize > 0 && holdIndices[(size_t) holdHead] + (uint64_t) window <= sampleIndex)
+        {
+            holdHead = (holdHead + 1) % window;
+            --holdSize;
+        }
+        while (holdSize > 0 && holdValues[(size_t) back()] >= needed)
+            --holdSize;
+        const auto slot = (size_t) ((holdHead + holdSize) % window);
+        holdValues[slot] = needed;
+        holdIndices[slot] = sampleIndex++;
+        ++holdSize;
+        const float held = holdValues[(size_t) holdHead];
+
+        release = held <= release ? held : release + (held - release) * releaseCoeff;
+
+        // Attack: the running sum is rebuilt once per lap, so rounding cannot build up
+        attackSum += (double) release - (double) attackValues[(size_t) attackPos];
+        attackValues[(size_t) attackPos] = release;
+        if (++attackPos == window)
+        {
+            attackPos = 0;
+            attackSum = 0.0;
+            for (auto v : attackValues) attackSum += v;
+        }
+
+        return (float) (attackSum / window);
+    }
+
+    int back() const { return (holdHead + holdSize - 1) % window; }
+
+    // Writes the chunk into the delay line, then reads back the samples window - 1 behind it, gained
+    void delayAndApply (float* line, float* data, int n)
+    {
+        const int firstWrite = juce::jmin (n, delaySize - delayPos);
+        juce::FloatVectorOperations::copy (line + delayPos, data, firstWrite);
+        juce::FloatVectorOperations::copy (line, data + firstWrite, n - firstWrite);
+
+        const int readPos = (delayPos - (window - 1) + delaySize) % delaySize;
+        const int firstRead = juce::jmin (n, delaySize - readPos);
+        juce::FloatVectorOperations::multiply (data, line + readPos, gains, firstRead);
+        juce::FloatVectorOperations::multiply (data + firstRead, line, gains + firstRead, n - firstRead);
+    }
+
+    double lookaheadMs = 5.0;
+    std::atomic<double> releaseMs { 80.0 };
+    std::atomic<float> ceiling { juce::Decibels::decibelsToGain (-0.3f) };
+    std::atomic<int> latency { 0 };
+    std::atomic<float> minGain { 1.0f };
+
+    double sampleRate = 48000.0;
+    int channels = maxChannels;
+    int window = 1;
+
+    // Audio Thread
+    std::vector<float> holdValues;
+    std::vector<uint64_t> holdIndices;
+    int holdHead = 0, holdSize = 0;
+    uint64_t sampleIndex = 0;
+    float release = 1.0f;
+    std::vector<float> attackValues;
+    double attackSum = 1.0;
+    int attackPos = 0;
+    std::vector<float> delayLines[maxChannels];
+    int delaySize = chunkSize, delayPos = 0;
+    float gains[chunkSize], peaks[chunkSize];
+};
@@ -0,0 +1,272 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "Track.h"
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Group or FX return bus: sums whatever is routed to it, runs an optional insert on the sum,
+// then has a fader, sends and an output like any track.
+class Bus : public Track
+{
+public:
+    enum class Kind { group, fxReturn };
+
+    Bus (const juce::String& name, Kind k) : Track (name, TrackType::Audio), kind (k) {}
+
+    ~Bus() override
+    {
+        if (auto* p = insert.load())
+            delete p;
+    }
+
+    Kind getKind() const { return kind; }
+
+    // Message Thread: same hand-over as InstrumentTrack::setInstrument
+    void setInsert (std::unique_ptr<juce::AudioProcessor> newInsert)
+    {
+        retireProcessor (insert.exchange (newInsert.release()));
+    }
+
+    // An insert may ring on after its input stops, so a bus with one is processed even when nothing reached it
+    bool hasInsert() const { return insert.load() != nullptr; }
+
+    void prepareToPlay (double sampleRate, int samplesPerBlock) override
+    {
+        prepareFader (sampleRate);
+        if (auto* p = insert.load())
+            p->prepareToPlay (sampleRate, samplesPerBlock);
+    }
+
+    void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+    {
+        if (auto* p = insert.load())
+            p->processBlock (buffer, midiMessages);
+    }
+
+    void releaseResources() override
+    {
+        if (auto* p = insert.load())
+            p->releaseResources();
+    }
+
+    void allNotesOff() override {}
+
+private:
+    const Kind kind;
+    std::atomic<juce::AudioProcessor*> insert { nullptr };
+};
+
+// The mixing graph flattened for the audio thread. The message thread compiles tracks -> buses
+// -> master into a list of steps, each bus after everything that feeds it, and gives the buses
+// preallocated buffers. Buses whose lifetimes do not overlap share a buffer (liveness analysis).
+// Executing it is a straight walk over the steps: no traversal, no allocation, no locks.
+// The plan also carries the track list the audio thread renders, and owns a reference to every
+// track in it, so a removed track lives until the last plan naming it has been reclaimed.
+// A plan is immutable apart from its buffers; the Mixer swaps in a new one when tracks or routing change.
+class RenderPlan
+{
+public:
+    static constexpr int master = -1;
+
+    // Message Thread. tracks render into their own buffers before the plan runs; buses are
+    // numbered by their position in the list. layoutVersion changes whenever track indices shift.
+    static std::unique_ptr<RenderPlan> compile (const std::vector<std::shared_ptr<Track>>& tracks, const std::vector<Bus*>& buses,
+                                                int blockSize, uint32_t layoutVersion = 0)
+    {
+        auto plan = std::unique_ptr<RenderPlan> (new RenderPlan());
+        const int numTracks = (int) tracks.size(), numBuses = (int) buses.size();
+        const int numNodes = numTracks + numBuses;
+
+        plan->trackOwners = tracks;
+        for (auto& t : tracks)
+            plan->trackList.push_back (t.get());
+        plan->layout = layoutVersion;
+
+        // Nodes 0..numTracks-1 are tracks, then buses; the master is numNodes
+        auto sourceOf = [&] (int node) -> Track* { return node < numTracks ? tracks[(size_t) node].get() : buses[(size_t) (node - numTracks)]; };
+        auto nodeOfBus = [&] (int bus) { return bus >= 0 && bus < numBuses ? numTracks + bus : numNodes; };
+
+        std::vector<std::vector<int>> inputs ((size_t) numNodes + 1);
+        for (int node = 0; node < numNodes; ++node)
+        {
+            auto* source = sourceOf (node);
+            inputs[(size_t) nodeOfBus (source->getOutputBus())].push_back (node);
+            for (auto& send : source->getSends())
+                if (send->bus >= 0 && send->bus < numBuses)
+                    inputs[(size_t) nodeOfBus (send->bus)].push_back (node);
+        }
+
+        // Depth-first from the master, so each bus comes right after its inputs and its buffer is
+        // live for as short a stretch as possible. Bus inputs go before track inputs, so a chain of
+        // groups only holds two buffers at a time. Otherwise inputs are visited in node order, and
+        // the sum order is fixed by the routing alone.
+        std::vector<int> order, state ((size_t) numNodes + 1, 0); // 0 new, 1 in progress, 2 done
+        std::function<void (int)> visit = [&] (int node) {
+            state[(size_t) node] = 1;
+            for (const bool busPass : { true, false })
+                for (int input : inputs[(size_t) node])
+                    if ((input >= numTracks) == busPass && state[(size_t) input] == 0) // 1 would be a cycle; the Mixer never builds one
+                        visit (input);
+            state[(size_t) node] = 2;
+            if (node < numNodes) order.push_back (node);
+        };
+        visit (numNodes);
+        for (int node = 0; node < numNodes; ++node)
+            if (state[(size_t) node] == 0) visit (node);
+
+        std::vector<int> position ((size_t) numNodes);
+        for (int i = 0; i < (int) order.size(); ++i)
+            position[(size_t) order[(size_t) i]] = i;
+
+        // A bus buffer is live from the first step writing into it to the bus's own step
+        std::vector<int> firstWrite ((size_t) numBuses), lastUse ((size_t) numBuses);
+        for (int bus = 0; bus < numBuses; ++bus)
+        {
+            const int node = numTracks + bus;
+            lastUse[(size_t) bus] = position[(size_t) node];
+            firstWrite[(size_t) bus] = position[(size_t) node];
+            for (int input : inputs[(size_t) node])
+                firstWrite[(size_t) bus] = std::min (firstWrite[(size_t) bus], position[(size_t) input]);
+        }
+
+        plan->busSlots.assign ((size_t) numBuses, -1);
+        std::vector<int> freeSlots;
+        int numSlots = 0;
+        for (int step = 0; step < (int) order.size(); ++step)
+        {
+            for (int bus = 0; bus < numBuses; ++bus)
+            {
+                if (firstWrite[(size_t) bus] != step) continue;
+                if (freeSlots.empty()) freeSlots.push_back (numSlots++);
+                plan->busSlots[(size_t) bus] = freeSlots.back();
+                freeSlots.pop_back();
+            }
+            for (int bus = 0; bus < numBuses; ++bus)
+                if (lastUse[(size_t) bus] == step)
+                    freeSlots.push_back (plan->busSlots[(size_t) bus]);
+        }
+
+        for (int node : order)
+        {
+            auto* source = sourceOf (node);
+            Step step;
+            step.source = source;
+            step.bus = node < numTracks ? master : node - numTracks;
+            step.output = source->getOutputBus() >= 0 && source->getOutputBus() < numBuses ? source->getOutputBus() : master;
+            for (auto& send : source->getSends())
+                if (send->bus >= 0 && send->bus < numBuses)
+                    (send->preFader ? step.preSends : step.postSends).push_back (send);
+            plan->steps.push_back (std::move (step));
+        }
+
+        plan->buffers.resize ((size_t) numSlots);
+        for (auto& buffer : plan->buffers)
+            buffer.setSize (2, juce::jmax (1, blockSize));
+        plan->busHasSignal.assign ((size_t) numBuses, 0);
+        plan->blockSize = blockSize;
+        return plan;
+    }
+
+    int getNumBuffers() const { return (int) buffers.size(); }
+    int getBlockSize() const { return blockSize; }
+
+    // Audio Thread: the tracks this plan mixes, in track order
+    int getNumTracks() const { return (int) trackList.size(); }
+    Track* getTrack (int index) const { return trackList[(size_t) index]; }
+    uint32_t getLayoutVersion() const { return layout; }
+
+    // Audio Thread: mixes the rendered tracks through the buses into output, which the caller cleared.
+    // Tracks the Mixer skipped contribute nothing, and a bus nothing reached is skipped too.
+    void execute (juce::AudioBuffer<float>& output, int numSamples)
+    {
+        jassert (numSamples <= blockSize);
+        std::fill (busHasSignal.begin(), busHasSignal.end(), 0);
+
+        for (auto& step : steps)
+        {
+            auto* source = step.source;
+            juce::AudioBuffer<float>* buffer = &source->getRenderBuffer();
+
+            if (step.bus != master)
+            {
+                buffer = &buffers[(size_t) busSlots[(size_t) step.bus]];
+                const bool reached = busHasSignal[(size_t) step.bus] != 0;
+                auto* bus = static_cast<Bus*> (source);
+                if (source->getIsMuted() || (! reached && ! bus->hasInsert()))
+                    continue;
+
+                juce::AudioBuffer<float> view (buffer->getArrayOfWritePointers(), buffer->getNumChannels(), numSamples);
+                if (! reached) view.clear();
+                bus->processBlock (view, noMidi);
+            }
+            else if (source->wasRenderSkipped())
+            {
+                continue;
+            }
+
+            for (auto& send : step.preSends)
+                sendInto (send->bus, *buffer, send->level, output, numSamples);
+
+            juce::AudioBuffer<float> view (buffer->getArrayOfWritePointers(), buffer->getNumChannels(), numSamples);
+            source->applyFader (view, numSamples);
+
+            for (auto& send : step.postSends)
+                sendInto (send->bus, *buffer, send->level, output, numSamples);
+
+            mixInto (step.output, *buffer, 1.0f, 1.0f, output, numSamples);
+        }
+    }
+
+private:
+    struct Step
+    {
+        Track* source = nullptr;
+        int bus = master;    // The bus this step processes, or master for a track
+        int output = master; // Where the faded signal goes
+        std::vector<std::shared_ptr<Send>> preSends, postSends; // Shared with the source, so levels stay live
+    };
+
+    RenderPlan() = default;
+
+    void sendInto (int bus, const juce::AudioBuffer<float>& source, SmoothedParameter<>& level, juce::AudioBuffer<float>& output, int numSamples)
+    {
+        level.beginBlock();
+        const float startGain = level.getCurrent();
+        mixInto (bus, source, startGain, level.skip (numSamples), output, numSamples);
+    }
+
+    // The first signal to reach a bus in a block is copied, so bus buffers never need clearing
+    void mixInto (int bus, const juce::AudioBuffer<float>& source, float startGain, float endGain, juce::AudioBuffer<float>& output, int numSamples)
+    {
+        auto& target = bus == master ? output : buffers[(size_t) busSlots[(size_t) bus]];
+        const bool first = bus != master && busHasSignal[(size_t) bus] == 0;
+        const int numChannels = juce::jmin (target.getNumChannels(), source.getNumChannels());
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            if (first) target.copyFromWithRamp (channel, 0, source.getReadPointer (channel), numSamples, startGain, endGain);
+            else       target.addFromWithRamp (channel, 0, source.getReadPointer (channel), numSamples, startGain, endGain);
+        }
+
+        if (bus != master)
+            busHasSignal[(size_t) bus] = 1;
+    }
+
+    std::vector<std::shared_ptr<Track>> trackOwners; // Only touched on the message thread
+    std::vector<Track*> trackList;
+    uint32_t layout = 0;
+
+    std::vector<Step> steps;
+    std::vector<int> busSlots; // Bus -> buffer
+    std::vector<juce::AudioBuffer<float>> buffers;
+    int blockSize = 0;
+
+    // Audio Thread scratch
+    std::vector<char> busHasSignal;
+    juce::MidiBuffer noMidi;
+
+    JUCE_DECLARE_NON_COPYABLE (RenderPlan)
+};
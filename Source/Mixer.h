@@ -2,99 +2,357 @@
 
 #include <JuceHeader.h>
 #include "Track.h"
+#include "RenderWorkerPool.h"
+#include "CallbackProfiler.h"
+#include "VoicePool.h"
+#include "MixGraph.h"
+#include "EpochReclaimer.h"
+#include "MasterLimiter.h"
 #include <vector>
 
+// The track list is copy-on-write: the message thread edits its own list and publishes a new
+// RenderPlan holding a copy, and the audio thread only ever reads the plan it pinned for the
+// block. Replaced plans, removed tracks and replaced instruments go through one EpochReclaimer
+// and are freed by collectGarbage() once no block can still see them, so there is no limit on
+// the number of tracks and nothing is freed or reallocated under the audio thread.
 class Mixer
 {
 public:
+    // Audio Thread: the tracks as published, for code outside processBlock (e.g. the sequencer).
+    // May be nested with processBlock.
+    class ReadScope
+    {
+    public:
+        explicit ReadScope (const Mixer& m) : pin (m.reclaimer), snapshot (m.plan.load()) {}
+
+        int getNumTracks() const { return snapshot->getNumTracks(); }
+        Track* getTrack (int index) const { return juce::isPositiveAndBelow (index, getNumTracks()) ? snapshot->getTrack (index) : nullptr; }
+
+    private:
+        EpochReclaimer::ReadScope pin;
+        const RenderPlan* snapshot;
+        JUCE_DECLARE_NON_COPYABLE (ReadScope)
+    };
+
     Mixer() {
-        tracks.reserve(32);
+        rebuildPlan();
     }
 
     void addTrack (std::unique_ptr<Track> track)
     {
         // On Message Thread
-        auto* t = track.release();
-        tracks.push_back(t);
-        numTracks.store((int)tracks.size());
+        if (preparedBlockSize > 0)
+            prepareTrack (*track);
+
+        track->reclaimer = &reclaimer;
+        tracks.push_back (std::shared_ptr<Track> (std::move (track)));
+        rebuildPlan();
     }
 
+    // Message Thread: later tracks move down one index. The track is freed by collectGarbage()
+    // once the audio thread has moved on to a plan without it.
+    bool removeTrack (int index)
+    {
+        if (! juce::isPositiveAndBelow (index, (int) tracks.size())) return false;
+
+        tracks.erase (tracks.begin() + index);
+        ++layoutVersion;
+        rebuildPlan();
+        return true;
+    }
+
+    // Message Thread: changes whenever track indices shift
+    uint32_t getLayoutVersion() const { return layoutVersion; }
+
     ~Mixer() {
-        for (auto* t : tracks) delete t;
+        renderPool.stop();
+        delete plan.load();
+        for (auto* b : buses) delete b;
+    }
+
+    // Message Thread: returns the new bus's index, which routing refers to
+    int addBus (const juce::String& name, Bus::Kind kind)
+    {
+        auto* bus = new Bus (name, kind);
+        bus->reclaimer = &reclaimer;
+        if (preparedBlockSize > 0)
+            bus->prepareToPlay (preparedSampleRate, preparedBlockSize);
+
+        buses.push_back (bus);
+        rebuildPlan();
+        return (int) buses.size() - 1;
+    }
+
+    int getNumBuses() const { return (int) buses.size(); }
+    Bus* getBus (int index) const { return index >= 0 && index < (int) buses.size() ? buses[(size_t) index] : nullptr; }
+
+    // Message Thread: where a track or bus sends its faded signal (RenderPlan::master or a bus).
+    // False if the bus does not exist or the route would feed a bus back into itself.
+    bool setOutput (Track& source, int bus)
+    {
+        if (bus != RenderPlan::master && ! canFeed (source, bus)) return false;
+        if (source.outputBus == bus) return true;
+
+        source.outputBus = bus;
+        source.touch();
+        rebuildPlan();
+        return true;
+    }
+
+    // Message Thread: adds a send to bus or updates the existing one. Changing only the level
+    // leaves the plan alone; moving the tap point replaces the send.
+    bool setSend (Track& source, int bus, float level, bool preFader)
+    {
+        level = juce::jlimit (0.0f, 2.0f, level);
+        auto& sends = source.sends;
+        auto existing = std::find_if (sends.begin(), sends.end(), [bus] (const auto& s) { return s->bus == bus; });
+
+        if (existing != sends.end() && (*existing)->preFader == preFader)
+        {
+            (*existing)->level.set (level);
+            source.touch();
+            return true;
+        }
+
+        if (existing == sends.end() && ! canFeed (source, bus)) return false;
+
+        auto send = std::make_shared<Send> (bus, preFader, level);
+        if (preparedSampleRate > 0.0)
+            send->level.prepare (preparedSampleRate, 0.05);
+
+        if (existing != sends.end()) *existing = std::move (send); // The running plan keeps the old one until it is retired
+        else                         sends.push_back (std::move (send));
+
+        source.touch();
+        rebuildPlan();
+        return true;
+    }
+
+    void removeSend (Track& source, int bus)
+    {
+        auto& sends = source.sends;
+        auto existing = std::find_if (sends.begin(), sends.end(), [bus] (const auto& s) { return s->bus == bus; });
+        if (existing == sends.end()) return;
+
+        sends.erase (existing);
+        source.touch();
+        rebuildPlan();
+    }
+
+    // Message Thread: frees plans, tracks and processors the audio thread has finished with
+    void collectGarbage() { reclaimer.collect(); }
+
+    // Message Thread: helper threads used to render tracks in parallel, applied on the next prepareToPlay.
+    // -1 picks one per physical core besides the audio thread; 0 renders everything on the audio thread.
+    void setNumRenderThreads (int numThreads) { numRenderThreads = numThreads; }
+
+    // Message Thread: total voices across all tracks, applied on the next prepareToPlay.
+    // VoicePool::autoBudget sizes it from the measured cost of a voice and the block period.
+    void setVoiceBudget (int numVoices) { voicePool.setBudget (numVoices); }
+    VoicePool::Counters getVoiceCounters() const { return voicePool.getCounters(); }
+
+    // Message Thread, before playback: times every track's render into the profiler (nullptr turns it off)
+    void setProfiler (CallbackProfiler* p) { profiler = p; }
+
+    // Message Thread: readies a processor for the running device before a track is given it
+    void prepareProcessor (juce::AudioProcessor& processor) const
+    {
+        if (preparedBlockSize > 0)
+            processor.prepareToPlay (preparedSampleRate, preparedBlockSize);
     }
 
     void prepareToPlay (double sampleRate, int samplesPerBlock)
     {
-        for (auto* t : tracks)
-            t->prepareToPlay (sampleRate, samplesPerBlock);
-            
-        tempBuffer.setSize (2, samplesPerBlock);
+        preparedSampleRate = sampleRate;
+        preparedBlockSize = samplesPerBlock;
+
+        for (auto& t : tracks)
+            prepareTrack (*t);
+        for (auto* b : buses)
+            b->prepareToPlay (sampleRate, samplesPerBlock);
+        rebuildPlan(); // Bus buffers are sized for the block
+        limiter.prepare (sampleRate, 2);
+
+        renderPool.start (numRenderThreads >= 0 ? numRenderThreads
+                                                : juce::jmax (0, juce::SystemStats::getNumPhysicalCpus() - 1));
+        voicePool.prepare (sampleRate, samplesPerBlock, renderPool.getNumWorkers());
     }
 
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
     {
+        const EpochReclaimer::ReadScope planPin (reclaimer);
+        auto* blockPlan = plan.load();
+        renderingPlan = blockPlan;
         buffer.clear();
         
-        int n = numTracks.load();
+        int n = blockPlan->getNumTracks();
         bool anySoloed = false;
+
+        // Indices moved, so notes the sequencer started under the old layout may never get their
+        // note-off: silence every track once
+        if (blockPlan->getLayoutVersion() != seenLayoutVersion)
+        {
+            seenLayoutVersion = blockPlan->getLayoutVersion();
+            for (int i = 0; i < n; ++i)
+                blockPlan->getTrack (i)->allNotesOff();
+        }
         
         for (int i = 0; i < n; ++i) {
-            if (tracks[i]->getIsSoloed()) {
+            if (blockPlan->getTrack (i)->getIsSoloed()) {
                 anySoloed = true;
                 break;
             }
         }
 
+        blockHasSolo = anySoloed;
+        blockSamples = juce::jmin (buffer.getNumSamples(), preparedBlockSize);
+
+        // A track that is idle with nothing scheduled would render silence: it is skipped and left out
+        // of the sum until an event wakes it
+        int numToRender = 0;
         for (int i = 0; i < n; ++i)
         {
-            auto* track = tracks[i];
-            
-            if (anySoloed && !track->getIsSoloed())
-                continue;
-            
-            if (track->getIsMuted())
-                continue;
-
-            tempBuffer.clear();
-            juce::MidiBuffer trackMidi; 
-            
-            track->processBlock (tempBuffer, trackMidi);
-            
-            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-                buffer.addFrom (channel, 0, tempBuffer, channel, 0, buffer.getNumSamples());
-        }
-        
-        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-        {
-            auto* data = buffer.getWritePointer (channel);
-            for (int j = 0; j < buffer.getNumSamples(); ++j)
-                data[j] = juce::jlimit (-1.0f, 1.0f, data[j]);
+            auto* track = blockPlan->getTrack (i);
+            const bool skip = isSilenced (*track) || (track->getScheduledMidi().isEmpty() && track->isIdle());
+            track->setRenderSkipped (skip);
+            if (skip)
+                track->getScheduledMidi().clear(); // A silenced track drops its events, as it always has
+            else
+                ++numToRender;
         }
+        numIdleTracks.store (n - numToRender, std::memory_order_relaxed);
+
+        // Voices are handed out in track order before any track starts rendering
+        voicePool.allocate (n, [blockPlan] (int i) {
+            auto* track = blockPlan->getTrack (i);
+            return VoicePool::Client { track->getVoiceBank(), track->wasRenderSkipped() ? nullptr : &track->getScheduledMidi(), track->getVoicePriority() };
+        });
+
+        // Every track renders dry into its own buffer, spread across the worker pool (not woken if all are idle)
+        if (numToRender > 0)
+            renderPool.run (n, [] (void* mixer, int index) { static_cast<Mixer*> (mixer)->renderTrack (index); }, this);
+
+        // Faders, sends and buses on this thread in plan order, so the result does not depend on scheduling
+        blockPlan->execute (buffer, blockSamples);
+
+        limiter.process (buffer, buffer.getNumSamples());
     }
 
     void allNotesOff()
     {
-        int n = numTracks.load();
-        for (int i = 0; i < n; ++i)
-            tracks[i]->allNotesOff();
+        for (auto& t : tracks)
+            t->allNotesOff();
     }
 
     void releaseResources()
     {
-        for (auto* t : tracks)
+        renderPool.stop();
+        for (auto& t : tracks)
             t->releaseResources();
     }
 
-    // Safe access for Message Thread
-    int getNumTracks() const { return numTracks.load(); }
+    // Message Thread (the audio thread uses a ReadScope)
+    int getNumTracks() const { return (int) tracks.size(); }
     Track* getTrack(int index) const { 
-        if (index >= 0 && index < numTracks.load())
-            return tracks[(size_t)index];
+        if (index >= 0 && index < (int) tracks.size())
+            return tracks[(size_t)index].get();
         return nullptr;
     }
 
+    int getNumRenderWorkers() const { return renderPool.getNumWorkers(); }
+
+    // Master limiter; lookahead changes apply on the next prepareToPlay
+    MasterLimiter& getLimiter() { return limiter; }
+
+    // Samples the master output lags the tracks by (the limiter's lookahead)
+    int getLatencySamples() const { return limiter.getLatencySamples(); }
+
+    // Tracks skipped as idle or silenced in the last block
+    int getNumIdleTracks() const { return numIdleTracks.load (std::memory_order_relaxed); }
+
 private:
-    std::vector<Track*> tracks; 
-    std::atomic<int> numTracks { 0 };
-    juce::AudioBuffer<float> tempBuffer;
+    // Message Thread: compiles the routing and swaps the result in for the next block
+    void rebuildPlan()
+    {
+        auto* next = RenderPlan::compile (tracks, buses, preparedBlockSize, layoutVersion).release();
+        auto* previous = plan.exchange (next);
+        reclaimer.retire (previous);
+        reclaimer.collect();
+    }
+
+    // Message Thread: false if bus is missing, or source is a bus that bus already feeds into
+    bool canFeed (const Track& source, int bus) const
+    {
+        if (getBus (bus) == nullptr) return false;
+
+        std::vector<int> pending { bus };
+        std::vector<bool> seen (buses.size(), false);
+        while (! pending.empty())
+        {
+            const int b = pending.back();
+            pending.pop_back();
+            if (b < 0 || b >= (int) buses.size() || seen[(size_t) b]) continue;
+            seen[(size_t) b] = true;
+
+            auto* downstream = buses[(size_t) b];
+            if (downstream == &source) return false;
+            pending.push_back (downstream->getOutputBus());
+            for (auto& send : downstream->getSends())
+                pending.push_back (send->bus);
+        }
+        return true;
+    }
+
+    void prepareTrack (Track& t)
+    {
+        t.prepareToPlay (preparedSampleRate, preparedBlockSize);
+        t.getRenderBuffer().setSize (2, preparedBlockSize);
+    }
+
+    bool isSilenced (Track& track) const
+    {
+        return (blockHasSolo && !track.getIsSoloed()) || track.getIsMuted();
+    }
+
+    // Audio Thread or render worker: touches only this track's state
+    void renderTrack (int index)
+    {
+        auto* track = renderingPlan->getTrack (index);
+        if (track->wasRenderSkipped()) return;
+
+        const CallbackProfiler::TrackScope timing (profiler, index, renderingPlan->getLayoutVersion());
+        auto& trackMidi = track->getScheduledMidi();
+
+        // View trimmed to this block, so event offsets line up with rendered samples
+        auto& target = track->getRenderBuffer();
+        juce::AudioBuffer<float> trackBuffer (target.getArrayOfWritePointers(), target.getNumChannels(), blockSamples);
+        trackBuffer.clear();
+        track->processBlock (trackBuffer, trackMidi);
+
+        trackMidi.clear();
+    }
+
+    // Message Thread; the audio thread sees both through the plan
+    std::vector<std::shared_ptr<Track>> tracks;
+    std::vector<Bus*> buses;
+    uint32_t layoutVersion = 0;
+
+    std::atomic<RenderPlan*> plan { nullptr };
+    EpochReclaimer reclaimer;
+
+    RenderWorkerPool renderPool;
+    VoicePool voicePool;
+    int numRenderThreads = -1;
+    CallbackProfiler* profiler = nullptr;
+    MasterLimiter limiter;
+    double preparedSampleRate = 0.0;
+    int preparedBlockSize = 0;
+
+    // Per-block state shared with the render workers (written before RenderWorkerPool::run publishes the job)
+    const RenderPlan* renderingPlan = nullptr;
+    bool blockHasSolo = false;
+    int blockSamples = 0;
+    uint32_t seenLayoutVersion = 0; // Audio Thread
+
+    std::atomic<int> numIdleTracks { 0 };
 };
\ No newline at end of file
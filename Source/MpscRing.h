@@ -0,0 +1,78 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <cstddef>
+
+// Bounded multi-producer, single-consumer ring (sequence-numbered cells, after Vyukov).
+// Producers claim a cell with one CAS and publish it with a release store of its sequence.
+// Neither side allocates, locks or makes a system call, so any of them may be the audio thread.
+template <typename T, size_t capacity>
+class MpscRing
+{
+public:
+    static_assert (capacity > 0 && (capacity & (capacity - 1)) == 0, "Capacity must be a power of two");
+
+    MpscRing()
+    {
+        for (size_t i = 0; i < capacity; ++i)
+            cells[i].sequence.store (i, std::memory_order_relaxed);
+    }
+
+    // Any thread. False if the ring is full.
+    bool push (const T& item)
+    {
+        auto pos = enqueuePos.load (std::memory_order_relaxed);
+        for (;;)
+        {
+            auto& cell = cells[pos & mask];
+            const auto seq = cell.sequence.load (std::memory_order_acquire);
+            const auto diff = (std::ptrdiff_t) seq - (std::ptrdiff_t) pos;
+
+            if (diff == 0)
+            {
+                if (enqueuePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.item = item;
+                    cell.sequence.store (pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false; // Full
+            }
+            else
+            {
+                pos = enqueuePos.load (std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only
+    bool pop (T& item)
+    {
+        auto& cell = cells[dequeuePos & mask];
+        if ((std::ptrdiff_t) cell.sequence.load (std::memory_order_acquire) - (std::ptrdiff_t) (dequeuePos + 1) < 0)
+            return false; // Empty, or the producer that claimed it has not finished writing
+
+        item = cell.item;
+        cell.sequence.store (dequeuePos + mask + 1, std::memory_order_release);
+        ++dequeuePos;
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    static constexpr size_t mask = capacity - 1;
+    Cell cells[capacity];
+    alignas (64) std::atomic<size_t> enqueuePos { 0 };
+    alignas (64) size_t dequeuePos = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (MpscRing)
+};
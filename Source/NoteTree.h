@@ -0,0 +1,293 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+struct NoteEvent
+{
+    int note;
+    float velocity;
+    double startBeat;
+    double durationBeats;
+
+    bool operator< (const NoteEvent& other) const { return startBeat < other.startBeat; }
+    bool operator== (const NoteEvent& other) const
+    {
+        return note == other.note && std::abs(startBeat - other.startBeat) < 0.01;
+    }
+};
+
+// Persistent B+tree of notes ordered by startBeat. Nodes are immutable and shared between
+// versions: an edit copies the leaf it changes and the path above it, O(log n) time and memory,
+// and shares everything else with the tree it was made from. A NoteTree is one shared_ptr, so
+// holding an old version is free and keeps it intact, which the undo history and the audio
+// thread's snapshots rely on.
+class NoteTree
+{
+public:
+    static constexpr size_t leafCapacity = 32;
+    static constexpr size_t branchCapacity = 32;
+
+    NoteTree() = default;
+
+    // O(n) for notes already sorted by startBeat
+    static NoteTree fromSorted (const NoteEvent* notes, size_t numNotes)
+    {
+        std::vector<NodePtr> level;
+        for (size_t i = 0; i < numNotes; i += leafCapacity)
+            level.push_back (makeLeaf ({ notes + i, notes + std::min (numNotes, i + leafCapacity) }));
+
+        while (level.size() > 1)
+        {
+            std::vector<NodePtr> parents;
+            for (size_t i = 0; i < level.size(); i += branchCapacity)
+                parents.push_back (makeBranch ({ level.begin() + (std::ptrdiff_t) i, level.begin() + (std::ptrdiff_t) std::min (level.size(), i + branchCapacity) }));
+            level = std::move (parents);
+        }
+
+        return level.empty() ? NoteTree() : NoteTree (std::move (level.front()));
+    }
+
+    size_t size() const { return root != nullptr ? root->count : 0; }
+    bool isEmpty() const { return root == nullptr; }
+
+    // Same version, i.e. nothing changed in between
+    bool isSameAs (const NoteTree& other) const { return root == other.root; }
+
+    // The note goes after any notes with the same start
+    NoteTree withNote (const NoteEvent& note) const
+    {
+        if (root == nullptr) return fromSorted (&note, 1);
+
+        NodePtr split;
+        auto updated = insert (root, note, split);
+        if (split != nullptr)
+            updated = makeBranch ({ std::move (updated), std::move (split) });
+        return NoteTree (std::move (updated));
+    }
+
+    // Without any note of this pitch starting strictly within window of startBeat
+    NoteTree withoutNote (int note, double startBeat, double window) const
+    {
+        if (root == nullptr) return *this;
+
+        auto updated = erase (root, note, startBeat - window, startBeat + window);
+        while (updated != nullptr && ! updated->isLeaf && updated->children.size() == 1)
+            updated = updated->children.front();
+        return NoteTree (std::move (updated));
+    }
+
+    // In startBeat order
+    template <typename Fn>
+    void forEach (Fn&& fn) const
+    {
+        if (root != nullptr) visitAll (*root, fn);
+    }
+
+    std::vector<NoteEvent> toVector() const
+    {
+        std::vector<NoteEvent> notes;
+        notes.reserve (size());
+        forEach ([&] (const NoteEvent& n) { notes.push_back (n); });
+        return notes;
+    }
+
+    // Audio Thread: visits every note starting in [from, to) in order, O(log n + k)
+    template <typename Fn>
+    void forEachNoteOn (double from, double to, Fn&& fn) const
+    {
+        if (root != nullptr) visitStarts (*root, from, to, fn);
+    }
+
+    // Audio Thread: visits every note ending in [from, to). Subtrees are skipped by their end range,
+    // so this is O(log n + k) unless long notes overlap the window from far back.
+    template <typename Fn>
+    void forEachNoteEnding (double from, double to, Fn&& fn) const
+    {
+        if (root != nullptr) visitEnds (*root, from, to, fn);
+    }
+
+private:
+    struct Node
+    {
+        bool isLeaf = true;
+        std::vector<NoteEvent> notes;                      // Leaf: sorted by startBeat
+        std::vector<std::shared_ptr<const Node>> children; // Branch: in order, never empty
+
+        // Summary of the subtree, for searching and pruning
+        size_t count = 0;
+        double firstStart = 0.0, lastStart = 0.0;
+        double minEnd = 0.0, maxEnd = 0.0;
+    };
+
+    using NodePtr = std::shared_ptr<const Node>;
+
+    explicit NoteTree (NodePtr r) : root (std::move (r)) {}
+
+    static NodePtr makeLeaf (std::vector<NoteEvent> notes)
+    {
+        auto leaf = std::make_shared<Node>();
+        leaf->notes = std::move (notes);
+        leaf->count = leaf->notes.size();
+        leaf->firstStart = leaf->notes.front().startBeat;
+        leaf->lastStart = leaf->notes.back().startBeat;
+        leaf->minEnd = leaf->maxEnd = leaf->notes.front().startBeat + leaf->notes.front().durationBeats;
+        for (const auto& n : leaf->notes)
+        {
+            leaf->minEnd = std::min (leaf->minEnd, n.startBeat + n.durationBeats);
+            leaf->maxEnd = std::max (leaf->maxEnd, n.startBeat + n.durationBeats);
+        }
+        return leaf;
+    }
+
+    static NodePtr makeBranch (std::vector<NodePtr> children)
+    {
+        auto branch = std::make_shared<Node>();
+        branch->isLeaf = false;
+        branch->children = std::move (children);
+        branch->firstStart = branch->children.front()->firstStart;
+        branch->lastStart = branch->children.back()->lastStart;
+        branch->minEnd = branch->children.front()->minEnd;
+        branch->maxEnd = branch->children.front()->maxEnd;
+        for (const auto& child : branch->children)
+        {
+            branch->count += child->count;
+            branch->minEnd = std::min (branch->minEnd, child->minEnd);
+            branch->maxEnd = std::max (branch->maxEnd, child->maxEnd);
+        }
+        return branch;
+    }
+
+    // Splits off the upper half of an overfull node into its own vector
+    template <typename T>
+    static std::vector<T> splitUpperHalf (std::vector<T>& items)
+    {
+        const auto half = (std::ptrdiff_t) items.size() / 2;
+        std::vector<T> upper (items.begin() + half, items.end());
+        items.erase (items.begin() + half, items.end());
+        return upper;
+    }
+
+    static NodePtr insert (const NodePtr& node, const NoteEvent& note, NodePtr& split)
+    {
+        if (node->isLeaf)
+        {
+            std::vector<NoteEvent> notes;
+            notes.reserve (node->notes.size() + 1);
+            notes.assign (node->notes.begin(), node->notes.end());
+            notes.insert (std::upper_bound (notes.begin(), notes.end(), note), note);
+            if (notes.size() > leafCapacity)
+                split = makeLeaf (splitUpperHalf (notes));
+            return makeLeaf (std::move (notes));
+        }
+
+        // The last child starting at or before the note, so equal starts stay in insertion order
+        auto it = std::upper_bound (node->children.begin(), node->children.end(), note.startBeat,
+                                    [] (double beat, const NodePtr& child) { return beat < child->firstStart; });
+        const auto index = it == node->children.begin() ? 0 : (size_t) (it - node->children.begin()) - 1;
+
+        std::vector<NodePtr> children;
+        children.reserve (node->children.size() + 1);
+        children.assign (node->children.begin(), node->children.end());
+        NodePtr childSplit;
+        children[index] = insert (children[index], note, childSplit);
+        if (childSplit != nullptr)
+            children.insert (children.begin() + (std::ptrdiff_t) index + 1, std::move (childSplit));
+
+        if (children.size() > branchCapacity)
+            split = makeBranch (splitUpperHalf (children));
+        return makeBranch (std::move (children));
+    }
+
+    // Returns the node itself when nothing matched, nullptr when nothing is left
+    static NodePtr erase (const NodePtr& node, int pitch, double lo, double hi)
+    {
+        if (node->lastStart <= lo || node->firstStart >= hi)
+            return node;
+
+        if (node->isLeaf)
+        {
+            auto matches = [&] (const NoteEvent& n) { return n.note == pitch && n.startBeat > lo && n.startBeat < hi; };
+            if (std::none_of (node->notes.begin(), node->notes.end(), matches))
+                return node;
+
+            std::vector<NoteEvent> notes;
+            std::remove_copy_if (node->notes.begin(), node->notes.end(), std::back_inserter (notes), matches);
+            return notes.empty() ? nullptr : makeLeaf (std::move (notes));
+        }
+
+        std::vector<NodePtr> children;
+        bool changed = false;
+        for (const auto& child : node->children)
+        {
+            auto updated = erase (child, pitch, lo, hi);
+            changed = changed || updated != child;
+            if (updated != nullptr)
+                children.push_back (std::move (updated));
+        }
+
+        if (! changed) return node;
+        return children.empty() ? nullptr : makeBranch (std::move (children));
+    }
+
+    template <typename Fn>
+    static void visitAll (const Node& node, Fn& fn)
+    {
+        if (node.isLeaf)
+        {
+            for (const auto& n : node.notes)
+                fn (n);
+            return;
+        }
+
+        for (const auto& child : node.children)
+            visitAll (*child, fn);
+    }
+
+    // Returns false once a note at or past `to` was reached
+    template <typename Fn>
+    static bool visitStarts (const Node& node, double from, double to, Fn& fn)
+    {
+        if (node.isLeaf)
+        {
+            auto it = std::lower_bound (node.notes.begin(), node.notes.end(), from, [] (const NoteEvent& n, double b) { return n.startBeat < b; });
+            for (; it != node.notes.end(); ++it)
+            {
+                if (it->startBeat >= to) return false;
+                fn (*it);
+            }
+            return true;
+        }
+
+        auto it = std::lower_bound (node.children.begin(), node.children.end(), from, [] (const NodePtr& c, double b) { return c->lastStart < b; });
+        for (; it != node.children.end(); ++it)
+            if (! visitStarts (**it, from, to, fn))
+                return false;
+        return true;
+    }
+
+    template <typename Fn>
+    static void visitEnds (const Node& node, double from, double to, Fn& fn)
+    {
+        if (node.maxEnd < from || node.minEnd >= to) return;
+
+        if (node.isLeaf)
+        {
+            for (const auto& n : node.notes)
+            {
+                const double end = n.startBeat + n.durationBeats;
+                if (end >= from && end < to)
+                    fn (n);
+            }
+            return;
+        }
+
+        for (const auto& child : node.children)
+            visitEnds (*child, from, to, fn);
+    }
+
+    NodePtr root;
+};
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectJson.h"
+#include "ProjectBinary.h"
+#include "Sequencer.h"
+#include <functional>
+#include <thread>
+
+// Renders a project faster than real time with no audio device and no UI.
+// Every track runs its own Sequencer -> InstrumentTrack -> InternalSynthProcessor chain
+// on a worker thread; the master is the sum of the stems in track order, so the
+// result does not depend on how many threads were used. Projects do not store bus routing,
+// so stems are post-fader and go straight to the master.
+class OfflineRenderer
+{
+public:
+    struct Settings
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numLoops = 1;
+        double tailSeconds = 2.0;
+        int numThreads = 0; // 0 = one per core
+    };
+
+    explicit OfflineRenderer (const Settings& s) : settings (s)
+    {
+        mixer.setNumRenderThreads (0); // Parallelism comes from rendering whole tracks per worker
+    }
+
+    // Loads a project in the getFullProjectJson format, creating one synth track per "tN" entry
+    bool loadProject (const juce::String& json)
+    {
+        auto project = juce::JSON::parse (json);
+        if (! project.isObject()) return false;
+
+        addTracks (ProjectJson::getNumTracks (project));
+        if (! ProjectJson::load (project, model, transport, mixer)) return false;
+
+        prepareLoadedProject();
+        return true;
+    }
+
+    // Loads either a binary container (see ProjectBinary) or a JSON project
+    bool loadProjectFile (const juce::File& file)
+    {
+        if (! ProjectBinary::isBinaryProject (file))
+            return loadProject (file.loadFileAsString());
+
+        ProjectBinary::Reader reader (file);
+        if (! reader.isValid()) return false;
+
+        addTracks (reader.getNumTracks());
+        if (! reader.load (model, transport, mixer)) return false;
+
+        prepareLoadedProject();
+        return true;
+    }
+
+    // Called on the worker thread that finished the track, e.g. to write its stem
+    std::function<void (int trackIndex, const juce::AudioBuffer<float>& stem)> onStemRendered;
+
+    void render()
+    {
+        const int numTracks = mixer.getNumTracks();
+        const int totalSamples = getNumScheduledSamples() + (int) (settings.tailSeconds * settings.sampleRate);
+
+        stems.clear();
+        stems.resize ((size_t) numTracks);
+
+        // The workers read through this thread's pin; nothing edits the model while rendering
+        const ProjectModel::ReadScope notesView (model);
+
+        std::atomic<int> nextTrack { 0 };
+        auto worker = [&] {
+            for (int i = nextTrack++; i < numTracks; i = nextTrack++)
+            {
+                renderTrack (i, notesView.getTrack (i), totalSamples);
+                if (onStemRendered) onStemRendered (i, stems[(size_t) i]);
+            }
+        };
+
+        const int numCores = (int) std::max (1u, std::thread::hardware_concurrency());
+        const int numWorkers = juce::jlimit (1, juce::jmax (1, numTracks), settings.numThreads > 0 ? settings.numThreads : numCores);
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < numWorkers; ++i)
+            workers.emplace_back (worker);
+        worker();
+        for (auto& w : workers)
+            w.join();
+
+        // Deterministic mixdown through the same master limiter as Mixer::processBlock. Each block
+        // goes through a scratch copy and comes back latency samples earlier, then zeros flush the
+        // last of it out, so the file lines up with the stems.
+        master.setSize (2, totalSamples);
+        master.clear();
+        for (auto& stem : stems)
+            for (int channel = 0; channel < master.getNumChannels(); ++channel)
+                master.addFrom (channel, 0, stem, channel, 0, totalSamples);
+
+        auto& limiter = mixer.getLimiter();
+        const int latency = limiter.getLatencySamples();
+        juce::AudioBuffer<float> block (master.getNumChannels(), settings.blockSize);
+        limiter.reset();
+
+        for (int pos = 0; pos < totalSamples + latency; pos += settings.blockSize)
+        {
+            const int numSamples = juce::jmin (settings.blockSize, totalSamples + latency - pos);
+            const int numInput = juce::jlimit (0, numSamples, totalSamples - pos);
+            block.clear();
+            for (int channel = 0; channel < block.getNumChannels(); ++channel)
+                block.copyFrom (channel, 0, master, channel, pos, numInput);
+
+            limiter.process (block, numSamples);
+
+            const int skip = juce::jlimit (0, numSamples, latency - pos); // The first latency samples out are the delay filling
+            for (int channel = 0; channel < block.getNumChannels(); ++channel)
+                master.copyFrom (channel, pos + skip - latency, block, channel, skip, numSamples - skip);
+        }
+    }
+
+    static bool writeWav (const juce::AudioBuffer<float>& buffer, const juce::File& file, double sampleRate, int bitsPerSample)
+    {
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+        if (stream == nullptr) return false;
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatWriter> writer (wav.createWriterFor (stream.get(), sampleRate, (unsigned int) buffer.getNumChannels(),
+                                                                              bitsPerSample, {}, 0));
+        if (writer == nullptr) return false;
+        stream.release(); // The writer owns the stream now
+
+        return writer->writeFromAudioSampleBuffer (buffer, 0, buffer.getNumSamples());
+    }
+
+    int getNumTracks() const { return mixer.getNumTracks(); }
+    juce::String getTrackName (int index) const { return mixer.getTrack (index)->getName(); }
+    const juce::AudioBuffer<float>& getMaster() const { return master; }
+    double getRenderedSeconds() const { return master.getNumSamples() / settings.sampleRate; }
+
+private:
+    void addTracks (int numTracks)
+    {
+        for (int i = mixer.getNumTracks(); i < numTracks; ++i)
+        {
+            auto track = std::make_unique<InstrumentTrack> ("Track " + juce::String (i + 1));
+            track->setInstrument (std::make_unique<InternalSynthProcessor>());
+            mixer.addTrack (std::move (track));
+        }
+    }
+
+    void prepareLoadedProject()
+    {
+        // Parameters first: prepareToPlay snaps the smoothed values to them instead of sweeping in
+        for (int i = 0; i < mixer.getNumTracks(); ++i)
+            if (auto* inst = dynamic_cast<InstrumentTrack*> (mixer.getTrack (i)))
+                if (auto* synth = dynamic_cast<InternalSynthProcessor*> (inst->getProcessor()))
+                    synth->updateParameters (inst->getOscType(), inst->getCutoff(), inst->getResonance());
+
+        mixer.prepareToPlay (settings.sampleRate, settings.blockSize);
+    }
+
+    int getNumScheduledSamples() const
+    {
+        const double beats = settings.numLoops * transport.getLoopLength();
+        return (int) std::ceil (beats / transport.getBeatsPerSample (settings.sampleRate));
+    }
+
+    void renderTrack (int index, const TrackNotes* notes, int totalSamples)
+    {
+        auto* track = mixer.getTrack (index);
+        auto& stem = stems[(size_t) index];
+        stem.setSize (2, totalSamples);
+
+        // Private clock per track, so tracks share nothing while rendering
+        Transport clock;
+        clock.setBpm (transport.getBpm());
+        clock.setLoopRegion (transport.getLoopStart(), transport.getLoopEnd());
+        clock.reset();
+        clock.setPlaying (true);
+
+        const int scheduledSamples = getNumScheduledSamples();
+        juce::AudioBuffer<float> block (2, settings.blockSize);
+        auto& midi = track->getScheduledMidi();
+        bool released = false;
+
+        for (int pos = 0; pos < totalSamples;)
+        {
+            // Blocks stop exactly at the end of the last loop so no extra notes get scheduled
+            const int limit = pos < scheduledSamples ? scheduledSamples : totalSamples;
+            const int numSamples = juce::jmin (settings.blockSize, limit - pos);
+            juce::AudioBuffer<float> view (block.getArrayOfWritePointers(), block.getNumChannels(), numSamples);
+            view.clear();
+
+            if (pos < scheduledSamples)
+            {
+                const double beatBefore = clock.getCurrentBeat();
+                clock.advance (numSamples, settings.sampleRate);
+                if (notes != nullptr)
+                    Sequencer::scheduleTrack (*notes, { beatBefore, clock.getCurrentBeat(), clock, numSamples, settings.sampleRate }, midi);
+            }
+            else if (! released)
+            {
+                midi.addEvent (juce::MidiMessage::allNotesOff (1), 0); // Let everything ring out through its release
+                released = true;
+            }
+
+            track->processBlock (view, midi);
+            track->applyFader (view, numSamples);
+            midi.clear();
+
+            for (int channel = 0; channel < stem.getNumChannels(); ++channel)
+                stem.copyFrom (channel, pos, view, channel, 0, numSamples);
+
+            pos += numSamples;
+        }
+    }
+
+    Settings settings;
+    ProjectModel model;
+    Transport transport;
+    Mixer mixer;
+
+    std::vector<juce::AudioBuffer<float>> stems;
+    juce::AudioBuffer<float> master;
+
+    JUCE_DECLARE_NON_COPYABLE (OfflineRenderer)
+};
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectModel.h"
+#include "Mixer.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+// Binary project container (.mmproj), built to be memory-mapped:
+//
+//   FileHeader                          magic, format version, transport, where the table is
+//   TrackEntry[numTracks]               synth params plus the offset and count of each note array
+//   NoteEvent[] per track, 8-aligned    the model's own note layout, sorted by startBeat
+//
+// Loading maps the file and hands each note array to ProjectModel as it is, so there is no
+// per-note parsing. Everything is little-endian with the layout pinned by the static_asserts
+// below. headerSize and trackEntrySize let a newer writer append fields that older readers skip.
+// JSON (ProjectJson) stays the exchange format for the AI bridge; MusicMakerConvert converts.
+class ProjectBinary
+{
+public:
+    static constexpr uint32_t formatVersion = 1;
+    static constexpr int maxTracks = 4096; // A sanity bound on numTracks, not part of the layout
+
+    // On-disk layout
+    static constexpr char fileMagic[8] = { 'M', 'M', 'P', 'R', 'O', 'J', '\r', '\n' }; // CR LF catches text-mode mangling
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t headerSize;
+        uint32_t numTracks;
+        uint32_t trackEntrySize;
+        uint64_t trackTableOffset;
+        uint64_t fileSize; // A shorter file was truncated
+        double bpm;
+        double loopStart;
+        double loopEnd;
+    };
+
+    struct TrackEntry
+    {
+        uint64_t notesOffset;
+        uint64_t numNotes;
+        int32_t oscType;
+        float cutoff;
+        float resonance;
+        uint32_t reserved;
+    };
+
+    // The note arrays are the in-memory NoteEvent, so its layout is part of the format
+    static_assert (std::is_trivially_copyable_v<NoteEvent> && sizeof (NoteEvent) == 24 && alignof (NoteEvent) == 8, "NoteEvent layout is part of the file format");
+    static_assert (offsetof (NoteEvent, velocity) == 4 && offsetof (NoteEvent, startBeat) == 8 && offsetof (NoteEvent, durationBeats) == 16, "NoteEvent layout is part of the file format");
+    static_assert (sizeof (FileHeader) == 64 && sizeof (TrackEntry) == 32, "Changing these needs a new format version");
+
+    // True if the file starts with the container's magic, whatever its extension
+    static bool isBinaryProject (const juce::File& file)
+    {
+        char magic[sizeof (fileMagic)] = {};
+        juce::FileInputStream in (file);
+        return in.openedOk() && in.read (magic, (int) sizeof (magic)) == (int) sizeof (magic)
+            && std::memcmp (magic, fileMagic, sizeof (magic)) == 0;
+    }
+
+    static bool write (const juce::File& file, const ProjectModel& model, const Transport& transport, const Mixer& mixer)
+    {
+        if (juce::ByteOrder::isBigEndian()) return false;
+
+        const auto allNotes = model.getAllNotes();
+        const int numTracks = juce::jmin (maxTracks, mixer.getNumTracks());
+
+        FileHeader header {};
+        std::memcpy (header.magic, fileMagic, sizeof (fileMagic));
+        header.formatVersion = formatVersion;
+        header.headerSize = sizeof (FileHeader);
+        header.numTracks = (uint32_t) numTracks;
+        header.trackEntrySize = sizeof (TrackEntry);
+        header.trackTableOffset = sizeof (FileHeader);
+        header.bpm = transport.getBpm();
+        header.loopStart = transport.getLoopStart();
+        header.loopEnd = transport.getLoopEnd();
+
+        std::vector<TrackEntry> table ((size_t) numTracks);
+        uint64_t offset = align (header.trackTableOffset + table.size() * sizeof (TrackEntry));
+
+        for (int i = 0; i < numTracks; ++i)
+        {
+            auto& entry = table[(size_t) i];
+            entry.oscType = 1;
+            entry.cutoff = 2000.0f;
+            entry.resonance = 0.7f;
+
+            if (auto* inst = dynamic_cast<InstrumentTrack*> (mixer.getTrack (i)))
+            {
+                entry.oscType = inst->getOscType();
+                entry.cutoff = inst->getCutoff();
+                entry.resonance = inst->getResonance();
+            }
+
+            auto it = allNotes.find (i);
+            entry.numNotes = it != allNotes.end() ? it->second.size() : 0;
+            entry.notesOffset = offset;
+            offset = align (offset + entry.numNotes * sizeof (NoteEvent));
+        }
+        header.fileSize = offset;
+
+        // Write next to the target and swap in, so a failed save never leaves half a project behind
+        juce::TemporaryFile temp (file);
+        {
+            juce::FileOutputStream out (temp.getFile());
+            if (! out.openedOk()) return false;
+
+            out.write (&header, sizeof (header));
+            out.write (table.data(), table.size() * sizeof (TrackEntry));
+
+            for (int i = 0; i < numTracks; ++i)
+            {
+                const auto& entry = table[(size_t) i];
+                padTo (out, entry.notesOffset);
+                if (entry.numNotes > 0)
+                    out.write (allNotes.at (i).data(), (size_t) entry.numNotes * sizeof (NoteEvent));
+            }
+            padTo (out, header.fileSize);
+
+            out.flush();
+            if (out.getStatus().failed()) return false;
+        }
+
+        return temp.overwriteTargetFileWithTemporary();
+    }
+
+    // Maps a container read-only and validates it up front; nothing is copied until load()
+    class Reader
+    {
+    public:
+        explicit Reader (const juce::File& file) : mapped (file, juce::MemoryMappedFile::readOnly)
+        {
+            valid = validate();
+        }
+
+        bool isValid() const { return valid; }
+        int getNumTracks() const { return valid ? (int) getHeader().numTracks : 0; }
+
+        // Params are applied to tracks that exist in the mixer, as with ProjectJson::load
+        bool load (ProjectModel& model, Transport& transport, Mixer& mixer) const
+        {
+            if (! valid) return false;
+
+            const auto& header = getHeader();
+            transport.setBpm (header.bpm);
+            transport.setLoopRegion (header.loopStart, header.loopEnd);
+
+            const ProjectModel::UndoGroup undoGroup (model);
+            model.clear();
+            for (int i = 0; i < (int) header.numTracks; ++i)
+            {
+                const auto entry = getEntry (i);
+                model.setTrackNotes (i, reinterpret_cast<const NoteEvent*> (getData() + entry.notesOffset), (size_t) entry.numNotes);
+
+                if (auto* inst = dynamic_cast<InstrumentTrack*> (mixer.getTrack (i)))
+                    inst->setParams (entry.oscType, entry.cutoff, entry.resonance);
+            }
+
+            return true;
+        }
+
+    private:
+        const char* getData() const { return static_cast<const char*> (mapped.getData()); }
+        const FileHeader& getHeader() const { return *reinterpret_cast<const FileHeader*> (getData()); }
+
+        // Copied out: with a newer writer's trackEntrySize the entries need not be aligned
+        TrackEntry getEntry (int index) const
+        {
+            const auto& header = getHeader();
+            TrackEntry entry {};
+            std::memcpy (&entry, getData() + header.trackTableOffset + (uint64_t) index * header.trackEntrySize, sizeof (entry));
+            return entry;
+        }
+
+        bool validate() const
+        {
+            const auto size = (uint64_t) mapped.getSize();
+            if (getData() == nullptr || size < sizeof (FileHeader) || juce::ByteOrder::isBigEndian()) return false;
+
+            const auto& header = getHeader();
+            if (std::memcmp (header.magic, fileMagic, sizeof (fileMagic)) != 0
+                || header.formatVersion == 0 || header.formatVersion > formatVersion
+                || header.headerSize < sizeof (FileHeader) || header.trackEntrySize < sizeof (TrackEntry)
+                || header.numTracks > (uint32_t) maxTracks || header.fileSize > size)
+                return false;
+
+            // Compared without adding to the offset, which a crafted file could wrap past 2^64
+            if (header.trackTableOffset < header.headerSize || header.trackTableOffset > size
+                || (uint64_t) header.numTracks * header.trackEntrySize > size - header.trackTableOffset)
+                return false;
+
+            // jlimit passes NaN through, and a NaN tempo or loop would poison the transport for the session
+            if (! std::isfinite (header.bpm) || ! std::isfinite (header.loopStart) || ! std::isfinite (header.loopEnd))
+                return false;
+
+            for (int i = 0; i < (int) header.numTracks; ++i)
+            {
+                const auto entry = getEntry (i);
+                if (entry.notesOffset % alignof (NoteEvent) != 0
+                    || entry.notesOffset > size
+                    || entry.numNotes > (size - entry.notesOffset) / sizeof (NoteEvent)
+                    || ! std::isfinite (entry.cutoff) || ! std::isfinite (entry.resonance))
+                    return false;
+
+                // The notes are handed to the model in place, so check them here like the header
+                const auto* notes = reinterpret_cast<const NoteEvent*> (getData() + entry.notesOffset);
+                for (uint64_t n = 0; n < entry.numNotes; ++n)
+                    if (! std::isfinite (notes[n].startBeat) || ! std::isfinite (notes[n].velocity) || ! std::isfinite (notes[n].durationBeats))
+                        return false;
+            }
+
+            return true;
+        }
+
+        juce::MemoryMappedFile mapped;
+        bool valid = false;
+
+        JUCE_DECLARE_NON_COPYABLE (Reader)
+    };
+
+private:
+    static uint64_t align (uint64_t offset) { return (offset + 7) & ~(uint64_t) 7; }
+
+    static void padTo (juce::OutputStream& out, uint64_t offset)
+    {
+        while ((uint64_t) out.getPosition() < offset)
+            out.writeByte (0);
+    }
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectModel.h"
+#include "Mixer.h"
+
+// Reads and writes the full-project JSON exchanged with the AI bridge.
+// Used by the app and by the headless renderer.
+class ProjectJson
+{
+public:
+    static constexpr int maxTracks = 4096; // Only a guard against absurd input; the Mixer has no limit
+
+    static juce::String toJson (const ProjectModel& model, const Transport& transport, const Mixer& mixer)
+    {
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        obj->setProperty("bpm", transport.getBpm());
+        obj->setProperty("loopStart", transport.getLoopStart());
+        obj->setProperty("loopEnd", transport.getLoopEnd());
+
+        for (int i = 0; i < mixer.getNumTracks(); ++i) {
+            juce::DynamicObject::Ptr tData = new juce::DynamicObject();
+            tData->setProperty("notes", model.toMinifiedVar(i));
+
+            if (auto* track = mixer.getTrack(i)) {
+                if (auto* inst = dynamic_cast<InstrumentTrack*>(track)) {
+                    tData->setProperty("osc", inst->getOscType());
+                    tData->setProperty("cut", inst->getCutoff());
+                    tData->setProperty("res", inst->getResonance());
+                }
+            }
+
+            obj->setProperty("t" + juce::String(i + 1), juce::var(tData.get()));
+        }
+
+        return juce::JSON::toString(juce::var(obj.get()));
+    }
+
+    // Highest "tN" key present, i.e. how many tracks the project needs
+    static int getNumTracks (const juce::var& project)
+    {
+        int numTracks = 0;
+        if (auto* dynObj = project.getDynamicObject())
+            for (const auto& prop : dynObj->getProperties())
+            {
+                const auto key = prop.name.toString();
+                if (key.startsWithChar ('t') && key.length() > 1 && key.substring (1).containsOnly ("0123456789"))
+                    numTracks = juce::jmax (numTracks, juce::jmin (maxTracks, key.substring (1).getIntValue()));
+            }
+        return numTracks;
+    }
+
+    // Returns false if the value is not a project object. Params are applied to tracks that exist in the mixer.
+    static bool load (const juce::var& project, ProjectModel& model, Transport& transport, Mixer& mixer)
+    {
+        if (! project.isObject()) return false;
+
+        if (project.hasProperty("bpm")) transport.setBpm(project["bpm"]);
+        if (project.hasProperty("loopStart") && project.hasProperty("loopEnd"))
+            transport.setLoopRegion(project["loopStart"], project["loopEnd"]);
+
+        const ProjectModel::UndoGroup undoGroup (model); // Undone as one step
+        model.clear();
+        if (auto* dynObj = project.getDynamicObject())
+        {
+            auto& props = dynObj->getProperties();
+            const int numTracks = getNumTracks (project);
+            for (int i = 1; i <= numTracks; ++i) {
+                juce::String trackKey = "t" + juce::String(i);
+                if (props.contains(trackKey)) {
+                    auto tVar = props[trackKey];
+                    if (tVar.isObject()) {
+                        model.fromMinifiedVar(i - 1, tVar["notes"]);
+
+                        if (auto* track = mixer.getTrack(i - 1)) {
+                            if (auto* inst = dynamic_cast<InstrumentTrack*>(track)) {
+                                int osc = tVar.hasProperty("osc") ? (int)tVar["osc"] : 1;
+                                float cut = tVar.hasProperty("cut") ? (float)tVar["cut"] : 2000.0f;
+                                float res = tVar.hasProperty("res") ? (float)tVar["res"] : 0.7f;
+                                inst->setParams(osc, cut, res);
+                            }
+                        }
+                    } else {
+                        // Legacy support for plain note arrays
+                        model.fromMinifiedVar(i - 1, tVar);
+                    }
+                }
+            }
+        }
+
+        return true;
+    }
+};
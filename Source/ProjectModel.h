@@ -4,111 +4,292 @@
 #include <vector>
 #include <algorithm>
 #include <mutex>
+#include <cmath>
+#include <map>
+#include <utility>
+#include "EpochReclaimer.h"
+#include "NoteTree.h"
 
-struct NoteEvent
+struct NoteOff
 {
+    double beat;
     int note;
-    float velocity;
-    double startBeat;
-    double durationBeats;
+};
 
-    bool operator< (const NoteEvent& other) const { return startBeat < other.startBeat; }
-    bool operator== (const NoteEvent& other) const 
-    { 
-        return note == other.note && std::abs(startBeat - other.startBeat) < 0.01; 
+// One track's notes in a snapshot. Copying it shares the tree, so snapshots and undo steps
+// only pay for the tracks that were edited.
+struct TrackNotes
+{
+    NoteTree notes; // Sorted by startBeat
+
+    // Audio Thread: visits every note starting in [from, to), O(log n + k)
+    template <typename Fn>
+    void forEachNoteOn (double from, double to, Fn&& fn) const
+    {
+        notes.forEachNoteOn (from, to, fn);
     }
+
+    // Audio Thread: visits every note ending in [from, to), in no particular order
+    template <typename Fn>
+    void forEachNoteOff (double from, double to, Fn&& fn) const
+    {
+        notes.forEachNoteEnding (from, to, [&] (const NoteEvent& n) { fn (NoteOff { n.startBeat + n.durationBeats, n.note }); });
+    }
+};
+
+// Immutable view of every track: the unit that is published to the audio thread and kept in the undo history
+struct NotesSnapshot
+{
+    std::vector<TrackNotes> tracks; // Indexed by track
+
+    const TrackNotes* getTrack (int trackIndex) const
+    {
+        if (juce::isPositiveAndBelow (trackIndex, (int) tracks.size()))
+            return &tracks[(size_t) trackIndex];
+        return nullptr;
+    }
+};
+
+// Note edits for one track, applied by ProjectModel::applyEdits under one lock with one publish.
+// Removals are applied before additions, so a move is a remove plus an add.
+class NoteEditBatch
+{
+public:
+    void add (const NoteEvent& note) { adds.push_back (note); }
+    void remove (int note, double startBeat) { removes.push_back ({ note, startBeat }); }
+    void move (int note, double fromBeat, const NoteEvent& to) { remove (note, fromBeat); add (to); }
+
+    void reserve (size_t numAdds) { adds.reserve (numAdds); }
+    bool isEmpty() const { return adds.empty() && removes.empty(); }
+
+private:
+    friend class ProjectModel;
+
+    struct NoteRef
+    {
+        int note;
+        double startBeat;
+    };
+
+    std::vector<NoteEvent> adds;
+    std::vector<NoteRef> removes;
 };
 
 class ProjectModel
 {
 public:
-    ProjectModel() = default;
+    ProjectModel() : current (std::make_shared<const NotesSnapshot>())
+    {
+        published.store (current.get());
+    }
+
+    // Audio Thread: lock-free, allocation-free access to the latest published notes
+    class ReadScope
+    {
+    public:
+        explicit ReadScope (const ProjectModel& m) : pin (m.reclaimer), snapshot (m.published.load()) {}
+
+        const NotesSnapshot& getSnapshot() const { return *snapshot; }
+        const TrackNotes* getTrack (int trackIndex) const { return snapshot->getTrack (trackIndex); }
+
+    private:
+        EpochReclaimer::ReadScope pin;
+        const NotesSnapshot* snapshot;
+        JUCE_DECLARE_NON_COPYABLE (ReadScope)
+    };
+
+    // Message Thread: edits made while one of these is alive are undone and redone as one step
+    class UndoGroup
+    {
+    public:
+        explicit UndoGroup (ProjectModel& m) : model (m)
+        {
+            std::lock_guard<std::mutex> lock (model.modelMutex);
+            if (model.undoGroupDepth++ == 0)
+                model.undoGroupRecorded = false;
+        }
+
+        ~UndoGroup()
+        {
+            std::lock_guard<std::mutex> lock (model.modelMutex);
+            --model.undoGroupDepth;
+        }
+
+    private:
+        ProjectModel& model;
+        JUCE_DECLARE_NON_COPYABLE (UndoGroup)
+    };
 
     void addNote (int trackIndex, NoteEvent note)
     {
+        if (! std::isfinite (note.startBeat)) return;
+
         std::lock_guard<std::mutex> lock(modelMutex);
-        note.note = juce::jlimit(0, 127, note.note);
-        note.velocity = juce::jlimit(0.0f, 1.0f, note.velocity);
-        note.durationBeats = std::max(0.01, note.durationBeats);
+        commitTrack (trackIndex, insertNote (getTree (trackIndex), sanitise (note)));
+    }
 
-        auto& trackNotes = trackData[trackIndex];
+    void removeNote (int trackIndex, int note, double startBeat)
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        commitTrack (trackIndex, getTree (trackIndex).withoutNote (note, startBeat, removeWindow));
+    }
 
-        // Deduplication: Remove any existing note at the exact same position and pitch
-        trackNotes.erase (std::remove_if (trackNotes.begin(), trackNotes.end(), [&](const NoteEvent& e) {
-            return e.note == note.note && std::abs(e.startBeat - note.startBeat) < 0.001;
-        }), trackNotes.end());
+    // Any number of adds, removes and moves for one track: one lock, one dedup pass, one publish, one undo step
+    void applyEdits (int trackIndex, const NoteEditBatch& batch)
+    {
+        if (batch.isEmpty()) return;
+
+        std::lock_guard<std::mutex> lock(modelMutex);
+        auto tree = getTree (trackIndex);
 
-        trackNotes.push_back (note);
-        std::sort (trackNotes.begin(), trackNotes.end());
+        for (const auto& r : batch.removes)
+            tree = tree.withoutNote (r.note, r.startBeat, removeWindow);
+
+        commitTrack (trackIndex, mergeNotes (std::move (tree), batch.adds));
     }
 
-    void removeNote (int trackIndex, int note, double startBeat)
+    // Later tracks move down one index. Older undo steps still use the old indices, so the history is dropped.
+    void removeTrack (int trackIndex)
     {
         std::lock_guard<std::mutex> lock(modelMutex);
-        if (trackData.find(trackIndex) == trackData.end()) return;
+        if (! juce::isPositiveAndBelow (trackIndex, (int) current->tracks.size())) return;
 
-        auto& trackNotes = trackData[trackIndex];
-        trackNotes.erase (std::remove_if (trackNotes.begin(), trackNotes.end(), [&](const NoteEvent& e) {
-            return e.note == note && std::abs(e.startBeat - startBeat) < 0.1;
-        }), trackNotes.end());
+        auto next = std::make_shared<NotesSnapshot> (*current);
+        next->tracks.erase (next->tracks.begin() + trackIndex);
+        setCurrent (std::move (next));
+        undoStack.clear();
+        redoStack.clear();
     }
 
     void clear() { 
         std::lock_guard<std::mutex> lock(modelMutex);
-        trackData.clear(); 
+        if (! current->tracks.empty())
+            commit (std::make_shared<const NotesSnapshot>());
     }
 
+    // Message Thread: undo and redo swap in a snapshot from the history and publish it as it is, O(1)
+    bool undo()
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        if (undoStack.empty()) return false;
+
+        redoStack.push_back (current);
+        setCurrent (std::move (undoStack.back()));
+        undoStack.pop_back();
+        return true;
+    }
+
+    bool redo()
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        if (redoStack.empty()) return false;
+
+        undoStack.push_back (current);
+        setCurrent (std::move (redoStack.back()));
+        redoStack.pop_back();
+        return true;
+    }
+
+    bool canUndo() const { std::lock_guard<std::mutex> lock(modelMutex); return ! undoStack.empty(); }
+    bool canRedo() const { std::lock_guard<std::mutex> lock(modelMutex); return ! redoStack.empty(); }
+
+    // E.g. after opening a project, which should not be undoable into the previous one
+    void clearHistory()
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        undoStack.clear();
+        redoStack.clear();
+    }
+
+    // Message Thread: frees snapshots the audio thread has finished with
+    void collectGarbage() { reclaimer.collect(); }
+
     std::vector<NoteEvent> getNotes(int trackIndex) const { 
         std::lock_guard<std::mutex> lock(modelMutex);
-        auto it = trackData.find(trackIndex);
-        if (it != trackData.end()) return it->second;
-        return {}; 
+        return getTree (trackIndex).toVector();
+    }
+
+    // Message Thread: changes whenever the track's notes change, so unchanged tracks can be skipped without copying
+    uint64_t getTrackVersion (int trackIndex) const
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        auto it = trackVersions.find(trackIndex);
+        return it != trackVersions.end() ? it->second : 0;
+    }
+
+    // The notes together with the version they belong to
+    std::vector<NoteEvent> getNotes (int trackIndex, uint64_t& version) const
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        auto versionIt = trackVersions.find(trackIndex);
+        version = versionIt != trackVersions.end() ? versionIt->second : 0;
+        return getTree (trackIndex).toVector();
+    }
+
+    // One track's notes as of now, for a worker to read at leisure: shares the tree, copies nothing
+    TrackNotes getTrackNotes (int trackIndex, uint64_t& version) const
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        auto versionIt = trackVersions.find(trackIndex);
+        version = versionIt != trackVersions.end() ? versionIt->second : 0;
+        return { getTree (trackIndex) };
     }
 
     std::map<int, std::vector<NoteEvent>> getAllNotes() const {
         std::lock_guard<std::mutex> lock(modelMutex);
-        return trackData;
+        std::map<int, std::vector<NoteEvent>> allNotes;
+        for (size_t i = 0; i < current->tracks.size(); ++i)
+            if (! current->tracks[i].notes.isEmpty())
+                allNotes[(int) i] = current->tracks[i].notes.toVector();
+        return allNotes;
     }
 
     juce::var toMinifiedVar(int trackIndex) const
     {
         std::lock_guard<std::mutex> lock(modelMutex);
         juce::Array<juce::var> notesArray;
-        auto it = trackData.find(trackIndex);
-        if (it != trackData.end()) {
-            for (const auto& n : it->second)
-            {
-                juce::Array<juce::var> noteData;
-                noteData.add(n.note);
-                noteData.add(std::round(n.velocity * 100) / 100.0);
-                noteData.add(std::round(n.startBeat * 100) / 100.0);
-                noteData.add(std::round(n.durationBeats * 100) / 100.0);
-                notesArray.add(noteData);
-            }
-        }
+        getTree (trackIndex).forEach ([&] (const NoteEvent& n) {
+            juce::Array<juce::var> noteData;
+            noteData.add(n.note);
+            noteData.add(std::round(n.velocity * 100) / 100.0);
+            noteData.add(std::round(n.startBeat * 100) / 100.0);
+            noteData.add(std::round(n.durationBeats * 100) / 100.0);
+            notesArray.add(noteData);
+        });
         return notesArray;
     }
 
     void fromMinifiedVar(int trackIndex, const juce::var& v)
     {
-        {
-            std::lock_guard<std::mutex> lock(modelMutex);
-            trackData[trackIndex].clear();
-        }
-        
+        // Parsed outside the lock, then merged as one batch
+        std::vector<NoteEvent> notes;
         if (auto* arr = v.getArray())
         {
+            notes.reserve ((size_t) arr->size());
             for (auto& noteVar : *arr)
             {
                 if (auto* n = noteVar.getArray())
                 {
                     if (n->size() >= 4)
                     {
-                        addNote(trackIndex, { (int)(*n)[0], (float)(*n)[1], (double)(*n)[2], (double)(*n)[3] });
+                        notes.push_back ({ (int)(*n)[0], (float)(*n)[1], (double)(*n)[2], (double)(*n)[3] });
                     }
                 }
             }
         }
+
+        std::lock_guard<std::mutex> lock(modelMutex);
+        commitTrack (trackIndex, mergeNotes ({}, notes));
+    }
+
+    // Replaces a track's notes in one copy, e.g. straight out of a mapped project file.
+    // Arrays that are already sorted and clean are taken as they are; anything else goes
+    // through the same clamping and deduplication as addNote.
+    void setTrackNotes (int trackIndex, const NoteEvent* notes, size_t numNotes)
+    {
+        std::lock_guard<std::mutex> lock(modelMutex);
+        commitTrack (trackIndex, isClean (notes, numNotes) ? NoteTree::fromSorted (notes, numNotes)
+                                                          : mergeNotes ({}, { notes, notes + numNotes }));
     }
 
     void saveToFile (const juce::File& file)
@@ -116,8 +297,7 @@ public:
         juce::DynamicObject::Ptr root = new juce::DynamicObject();
         root->setProperty("bpm", 120.0);
         
-        std::lock_guard<std::mutex> lock(modelMutex);
-        for (auto const& [idx, notes] : trackData) {
+        for (auto const& [idx, notes] : getAllNotes()) {
             root->setProperty("t" + juce::String(idx + 1), toMinifiedVar(idx));
         }
         
@@ -125,8 +305,180 @@ public:
     }
 
 private:
-    std::map<int, std::vector<NoteEvent>> trackData;
+    // True if insertNote would keep every note unchanged and in this order
+    static bool isClean (const NoteEvent* notes, size_t numNotes)
+    {
+        for (size_t i = 0; i < numNotes; ++i)
+        {
+            const auto& n = notes[i];
+            if (n.note < 0 || n.note > 127 || ! (n.velocity >= 0.0f && n.velocity <= 1.0f)
+                || ! std::isfinite (n.startBeat) || ! (n.durationBeats >= 0.01 && std::isfinite (n.durationBeats)))
+                return false;
+
+            if (i == 0) continue;
+            if (n.startBeat < notes[i - 1].startBeat) return false;
+
+            // Sorted, so a duplicate can only sit among the few notes just before this one
+            for (size_t j = i; j-- > 0 && n.startBeat - notes[j].startBeat < 0.001;)
+                if (notes[j].note == n.note) return false;
+        }
+        return true;
+    }
+
+    static constexpr double duplicateWindow = 0.001; // Same pitch closer than this replaces the older note
+    static constexpr double removeWindow = 0.1;
+
+    // jlimit passes NaN through, so these compare the other way round: NaN ends up at the floor
+    static NoteEvent sanitise (NoteEvent note)
+    {
+        note.note = juce::jlimit(0, 127, note.note);
+        note.velocity = note.velocity >= 0.0f ? juce::jmin (note.velocity, 1.0f) : 0.0f;
+        note.durationBeats = note.durationBeats >= 0.01 && std::isfinite (note.durationBeats) ? note.durationBeats : 0.01;
+        return note;
+    }
+
+    // Deduplication: the new note replaces any existing note at the same position and pitch
+    static NoteTree insertNote (const NoteTree& tree, const NoteEvent& note)
+    {
+        return tree.withoutNote (note.note, note.startBeat, duplicateWindow).withNote (note);
+    }
+
+    // insertNote for a whole batch: sorted once, duplicates inside it resolved in one sweep (of two
+    // same-pitch notes closer than duplicateWindow the one added later wins), survivors merged in.
+    // Same result as inserting one by one, short of chains of near-duplicates each under the
+    // window apart, where the one-by-one result depends on insertion order.
+    static NoteTree mergeNotes (NoteTree tree, const std::vector<NoteEvent>& adds)
+    {
+        struct Ranked
+        {
+            NoteEvent note;
+            size_t order;
+            bool keep;
+        };
+
+        std::vector<Ranked> sorted;
+        sorted.reserve (adds.size());
+        for (size_t i = 0; i < adds.size(); ++i)
+            if (std::isfinite (adds[i].startBeat)) // A note with nowhere to go; NaN would also break the sort
+                sorted.push_back ({ sanitise (adds[i]), i, true });
+
+        std::sort (sorted.begin(), sorted.end(), [] (const Ranked& a, const Ranked& b) {
+            return a.note.startBeat != b.note.startBeat ? a.note.startBeat < b.note.startBeat : a.order < b.order;
+        });
+
+        for (size_t i = 1; i < sorted.size(); ++i)
+        {
+            auto& later = sorted[i];
+            for (size_t j = i; j-- > 0 && later.note.startBeat - sorted[j].note.startBeat < duplicateWindow;)
+            {
+                auto& earlier = sorted[j];
+                if (! earlier.keep || earlier.note.note != later.note.note) continue;
+
+                if (earlier.order < later.order) earlier.keep = false;
+                else { later.keep = false; break; }
+            }
+        }
+
+        std::vector<NoteEvent> survivors;
+        survivors.reserve (sorted.size());
+        for (const auto& r : sorted)
+            if (r.keep) survivors.push_back (r.note);
+
+        // A few notes are cheaper to path-copy in; more than that rebuilds the track in one merge
+        if (survivors.size() * 8 < tree.size())
+        {
+            for (const auto& n : survivors)
+                tree = insertNote (tree, n);
+            return tree;
+        }
+
+        auto existing = tree.toVector();
+        existing.erase (std::remove_if (existing.begin(), existing.end(), [&] (const NoteEvent& e) {
+            auto it = std::upper_bound (survivors.begin(), survivors.end(), e.startBeat - duplicateWindow,
+                                        [] (double beat, const NoteEvent& n) { return beat < n.startBeat; });
+            for (; it != survivors.end() && it->startBeat < e.startBeat + duplicateWindow; ++it)
+                if (it->note == e.note) return true;
+            return false;
+        }), existing.end());
+
+        std::vector<NoteEvent> merged;
+        merged.reserve (existing.size() + survivors.size());
+        std::merge (existing.begin(), existing.end(), survivors.begin(), survivors.end(), std::back_inserter (merged));
+        return NoteTree::fromSorted (merged.data(), merged.size());
+    }
+
+    // Called with modelMutex held
+    const NoteTree& getTree (int trackIndex) const
+    {
+        static const NoteTree empty;
+        auto* track = current->getTrack (trackIndex);
+        return track != nullptr ? track->notes : empty;
+    }
+
+    // Called with modelMutex held: shares every other track with the current snapshot
+    void commitTrack (int trackIndex, NoteTree tree)
+    {
+        if (trackIndex < 0 || getTree (trackIndex).isSameAs (tree)) return;
+
+        auto next = std::make_shared<NotesSnapshot> (*current);
+        if (next->tracks.size() <= (size_t) trackIndex)
+            next->tracks.resize ((size_t) trackIndex + 1);
+        next->tracks[(size_t) trackIndex].notes = std::move (tree);
+
+        commit (std::move (next));
+    }
+
+    // Called with modelMutex held: records the current snapshot as an undo step, then replaces it
+    void commit (std::shared_ptr<const NotesSnapshot> next)
+    {
+        if (undoGroupDepth == 0 || ! undoGroupRecorded)
+            undoStack.push_back (current);
+        undoGroupRecorded = undoGroupDepth > 0;
+        redoStack.clear();
+
+        setCurrent (std::move (next));
+    }
+
+    // Called with modelMutex held
+    void setCurrent (std::shared_ptr<const NotesSnapshot> next)
+    {
+        // Tracks whose tree changed get a new version, so the UI resends them
+        const auto numTracks = std::max (current->tracks.size(), next->tracks.size());
+        for (size_t i = 0; i < numTracks; ++i)
+        {
+            const auto* before = current->getTrack ((int) i);
+            const auto* after = next->getTrack ((int) i);
+            const bool same = before != nullptr && after != nullptr ? before->notes.isSameAs (after->notes)
+                                                                    : (before == nullptr || before->notes.isEmpty()) && (after == nullptr || after->notes.isEmpty());
+            if (! same)
+                trackVersions[(int) i] = ++editVersion;
+        }
+
+        // The history may still own the replaced snapshot; the reclaimer only holds it until no reader can see it
+        auto replaced = std::exchange (current, std::move (next));
+        published.store (current.get());
+        reclaimer.retire (std::move (replaced));
+        reclaimer.collect();
+    }
+
+    std::shared_ptr<const NotesSnapshot> current;
+    std::vector<std::shared_ptr<const NotesSnapshot>> undoStack, redoStack; // Snapshots share unedited trees
+    int undoGroupDepth = 0;
+    bool undoGroupRecorded = false;
+
+    std::map<int, uint64_t> trackVersions; // Outlive clear(), so a cleared track reads as changed
+    uint64_t editVersion = 0;
     mutable std::mutex modelMutex;
+
+    std::atomic<const NotesSnapshot*> published { nullptr };
+    EpochReclaimer reclaimer;
+};
+
+// A loop region as one value, so a reader never pairs one region's start with another's end
+struct LoopRegion
+{
+    double start = 0.0, end = 16.0;
+    double getLength() const { return end - start; }
 };
 
 class Transport
@@ -134,7 +486,7 @@ class Transport
 public:
     Transport() : bpm (120.0), isPlaying (false), isRecording (false), currentBeat (0.0) {}
 
-    void setBpm (double newBpm) { bpm = juce::jlimit(20.0, 300.0, newBpm); }
+    void setBpm (double newBpm) { bpm = juce::jlimit(20.0, 300.0, newBpm); ++stateVersion; }
     double getBpm() const { return bpm; }
 
     void setPlaying (bool shouldPlay) 
@@ -151,24 +503,74 @@ public:
     }
     bool getIsRecording() const { return isRecording; }
 
-    void advance (int numSamples, double sampleRate)
+    double getBeatsPerSample (double sampleRate) const
+    {
+        double secondsPerBeat = 60.0 / bpm;
+        return 1.0 / (sampleRate * secondsPerBeat);
+    }
+
+    // One writer at a time (the message thread, or a private clock's owner). Published as a
+    // seqlock: the sequence is odd while the two halves are being stored.
+    void setLoopRegion (double startBeat, double endBeat)
+    {
+        startBeat = juce::jmax (0.0, startBeat);
+        endBeat = juce::jmax (startBeat + 0.25, endBeat);
+
+        const auto sequence = loopSequence.load (std::memory_order_relaxed);
+        loopSequence.store (sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        loopStart.store (startBeat, std::memory_order_relaxed);
+        loopEnd.store (endBeat, std::memory_order_relaxed);
+        loopSequence.store (sequence + 2, std::memory_order_release);
+        ++stateVersion;
+    }
+
+    // Any thread: a region that was set as a whole. Only retries while a write is in between its two stores.
+    LoopRegion getLoopRegion() const
+    {
+        for (;;)
+        {
+            const auto sequence = loopSequence.load (std::memory_order_acquire);
+            if ((sequence & 1) != 0) continue;
+
+            const LoopRegion region { loopStart.load (std::memory_order_relaxed), loopEnd.load (std::memory_order_relaxed) };
+            std::atomic_thread_fence (std::memory_order_acquire);
+            if (loopSequence.load (std::memory_order_relaxed) == sequence)
+                return region;
+        }
+    }
+
+    double getLoopStart() const { return getLoopRegion().start; }
+    double getLoopEnd() const { return getLoopRegion().end; }
+    double getLoopLength() const { return getLoopRegion().getLength(); }
+
+    // Audio Thread: loop is the region read once for the block, so everything in it agrees on one
+    void advance (int numSamples, double sampleRate, const LoopRegion& loop)
     {
         if (!isPlaying) return;
 
-        double secondsPerBeat = 60.0 / bpm;
-        double beatsPerSample = 1.0 / (sampleRate * secondsPerBeat);
-        currentBeat += numSamples * beatsPerSample;
+        currentBeat += numSamples * getBeatsPerSample (sampleRate);
         
-        if (currentBeat >= 16.0)
-            currentBeat -= 16.0;
+        if (currentBeat >= loop.end)
+            currentBeat = loop.start + std::fmod (currentBeat - loop.start, loop.getLength());
     }
 
-    void reset() { currentBeat = 0.0; }
+    // For a private clock whose region nothing else changes
+    void advance (int numSamples, double sampleRate) { advance (numSamples, sampleRate, getLoopRegion()); }
+
+    void reset() { currentBeat = getLoopRegion().start; }
     double getCurrentBeat() const { return currentBeat; }
 
+    // Changes with tempo or loop region (not with the playhead), so the UI only resends them when needed
+    uint32_t getStateVersion() const { return stateVersion.load(); }
+
 private:
     double bpm;
     bool isPlaying;
     bool isRecording;
     double currentBeat;
+    std::atomic<double> loopStart { 0.0 };
+    std::atomic<double> loopEnd { 16.0 };
+    std::atomic<uint32_t> loopSequence { 0 };
+    std::atomic<uint32_t> stateVersion { 0 };
 };
\ No newline at end of file
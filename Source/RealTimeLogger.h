@@ -1,20 +1,36 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "MpscRing.h"
 #include <fstream>
 #include <vector>
 #include <mutex>
+#include <algorithm>
+#include <cstdio>
 
+// Two ways in:
+//  - log (String) for the message thread. It builds a String, so it allocates.
+//  - event (format, args...) for any thread, including the audio thread. It copies a
+//    fixed-size binary record (format pointer, tick count, up to four numbers) into a
+//    lock-free ring and returns. It never allocates, formats, locks or makes a system call.
+// The writer thread turns both into timestamped lines for the log file and the UI feed.
 class RealTimeLogger : private juce::Thread
 {
 public:
+    static constexpr int maxEventArgs = 4;
+
     RealTimeLogger() : juce::Thread ("RealTimeLogger")
     {
         auto logFile = juce::File ("C:\\music_maker\\debug_log.txt");
         if (!logFile.exists()) logFile.create();
-        
+
         fileStream.open (logFile.getFullPathName().toRawUTF8(), std::ios::out | std::ios::app);
-        fifo.setTotalSize (1000);
+
+        // Ticks are monotonic; this pair maps them back to wall-clock time when formatting
+        startTicks = juce::Time::getHighResolutionTicks();
+        startMillis = juce::Time::currentTimeMillis();
+
+        lines.reserve (eventCapacity);
         startThread();
     }
 
@@ -24,65 +40,119 @@ public:
         if (fileStream.is_open()) fileStream.close();
     }
 
+    // Message Thread
     static void log (const juce::String& message)
     {
         if (auto* instance = getInstance())
             instance->pushMessage (message);
     }
 
-    // Get logs for UI (called from Message Thread)
+    // Any thread, real-time safe. format must be a string literal (only the pointer is stored)
+    // whose placeholders all take a double, e.g. event ("Block %.0f: %.1f us", n, micros).
+    template <typename... Args>
+    static void event (const char* format, Args... args)
+    {
+        static_assert (sizeof... (Args) <= maxEventArgs, "Too many event arguments");
+
+        if (auto* instance = getInstance())
+        {
+            Event e { format, juce::Time::getHighResolutionTicks(), { (double) args... } };
+            if (! instance->events.push (e))
+                instance->droppedEvents.fetch_add (1, std::memory_order_relaxed);
+        }
+    }
+
+    // Events lost because the ring was full
+    static int getNumDroppedEvents()
+    {
+        auto* instance = getInstance();
+        return instance != nullptr ? instance->droppedEvents.load (std::memory_order_relaxed) : 0;
+    }
+
+    // Get logs for UI (called from Message Thread). Lock-free: the writer thread is the only producer.
     static juce::StringArray getPendingUiLogs()
     {
+        juce::StringArray logs;
         if (auto* instance = getInstance())
         {
-            std::lock_guard<std::mutex> lock (instance->uiLogMutex);
-            auto logs = instance->uiLogs;
-            instance->uiLogs.clear();
-            return logs;
+            auto scope = instance->uiFifo.read (instance->uiFifo.getNumReady());
+            scope.forEach ([&] (int index) { logs.add (std::move (instance->uiLines[index])); });
         }
-        return {};
+        return logs;
     }
 
 private:
+    static constexpr int eventCapacity = 4096; // Power of two
+    static constexpr int uiCapacity = 100;
+
+    struct Event
+    {
+        const char* format;
+        juce::int64 ticks;
+        double args[maxEventArgs];
+    };
+
+    struct Line
+    {
+        juce::int64 ticks;
+        juce::String text;
+    };
+
     void pushMessage (const juce::String& message)
     {
-        auto timestamp = juce::Time::getCurrentTime().toString (true, true);
-        auto msgWithTimestamp = timestamp + ": " + message;
-        
-        int start1, size1, start2, size2;
-        fifo.prepareToWrite (1, start1, size1, start2, size2);
-        
-        if (size1 > 0)
-        {
-            messages[start1] = msgWithTimestamp;
-            fifo.finishedWrite (1);
-        }
+        std::lock_guard<std::mutex> lock (messageMutex); // Message Thread and writer only, never the audio thread
+        pendingMessages.push_back ({ juce::Time::getHighResolutionTicks(), message });
+    }
 
-        // Also push to UI queue (thread safe)
+    void run() override
+    {
+        while (!threadShouldExit())
         {
-            std::lock_guard<std::mutex> lock (uiLogMutex);
-            uiLogs.add (msgWithTimestamp);
-            if (uiLogs.size() > 100) uiLogs.remove (0);
+            drain();
+            wait (50);
         }
+        drain();
     }
 
-    void run() override
+    // Formats everything queued since the last pass, in time order, into the file and the UI feed
+    void drain()
     {
-        while (!threadShouldExit())
         {
-            int start1, size1, start2, size2;
-            int numReady = fifo.getNumReady();
-            
-            if (numReady > 0)
-            {
-                fifo.prepareToRead (numReady, start1, size1, start2, size2);
-                for (int i = 0; i < size1; ++i) fileStream << messages[start1 + i] << "\n";
-                for (int i = 0; i < size2; ++i) fileStream << messages[start2 + i] << "\n";
-                fileStream.flush();
-                fifo.finishedRead (size1 + size2);
-            }
-            wait (100);
+            std::lock_guard<std::mutex> lock (messageMutex);
+            for (auto& m : pendingMessages)
+                lines.push_back (std::move (m));
+            pendingMessages.clear();
+        }
+
+        Event e;
+        while (events.pop (e))
+        {
+            char text[256];
+            std::snprintf (text, sizeof (text), e.format, e.args[0], e.args[1], e.args[2], e.args[3]);
+            lines.push_back ({ e.ticks, juce::String (text) });
+        }
+
+        if (lines.empty()) return;
+
+        std::stable_sort (lines.begin(), lines.end(), [] (const Line& a, const Line& b) { return a.ticks < b.ticks; });
+
+        for (auto& line : lines)
+        {
+            auto msgWithTimestamp = formatTicks (line.ticks) + ": " + line.text;
+            fileStream << msgWithTimestamp << "\n";
+
+            // If the UI falls more than uiCapacity lines behind, the excess only reaches the file
+            auto scope = uiFifo.write (1);
+            scope.forEach ([&] (int index) { uiLines[index] = msgWithTimestamp; });
         }
+        fileStream.flush();
+        lines.clear();
+    }
+
+    juce::String formatTicks (juce::int64 ticks) const
+    {
+        const auto millis = startMillis + (juce::int64) (juce::Time::highResolutionTicksToSeconds (ticks - startTicks) * 1000.0);
+        return juce::Time (millis).toString (true, true);
     }
 
     static RealTimeLogger* getInstance()
@@ -91,12 +161,18 @@ private:
         return &instance;
     }
 
-    juce::AbstractFifo fifo { 1000 };
-    juce::String messages[1000];
+    MpscRing<Event, (size_t) eventCapacity> events;
+    std::atomic<int> droppedEvents { 0 };
+
+    std::mutex messageMutex;
+    std::vector<Line> pendingMessages;
+
+    std::vector<Line> lines; // Writer thread scratch
+    juce::int64 startTicks = 0, startMillis = 0;
     std::ofstream fileStream;
 
-    std::mutex uiLogMutex;
-    juce::StringArray uiLogs;
+    juce::AbstractFifo uiFifo { uiCapacity };
+    juce::String uiLines[uiCapacity];
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealTimeLogger)
-};
\ No newline at end of file
+};
@@ -0,0 +1,89 @@
+#include <JuceHeader.h>
+#include "OfflineRenderer.h"
+#include <iostream>
+
+// Headless batch renderer: MusicMakerRender <project.json|.mmproj> <output.wav> [options]
+static void printUsage()
+{
+    std::cout << "Usage: MusicMakerRender <project.json|.mmproj> <output.wav> [options]\n"
+                 "  --rate=<hz>        Sample rate (default 48000)\n"
+                 "  --block=<samples>  Block size (default 512)\n"
+                 "  --bits=<16|24|32>  WAV bit depth (default 24)\n"
+                 "  --loops=<n>        Times to play the loop region (default 1)\n"
+                 "  --tail=<seconds>   Release tail after the last loop (default 2)\n"
+                 "  --threads=<n>      Worker threads (default: one per core)\n"
+                 "  --stems=<dir>      Also write one WAV per track into <dir>\n";
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    juce::StringArray positional;
+    for (auto& arg : args.arguments)
+        if (! arg.isOption())
+            positional.add (arg.text);
+
+    if (args.containsOption ("--help|-h") || positional.size() < 2)
+    {
+        printUsage();
+        return positional.size() < 2 ? 1 : 0;
+    }
+
+    auto optionOr = [&] (const char* option, const juce::String& fallback) {
+        auto value = args.getValueForOption (option);
+        return value.isNotEmpty() ? value : fallback;
+    };
+
+    OfflineRenderer::Settings settings;
+    settings.sampleRate = juce::jlimit (8000.0, 384000.0, optionOr ("--rate", "48000").getDoubleValue());
+    settings.blockSize = juce::jlimit (16, 8192, optionOr ("--block", "512").getIntValue());
+    settings.numLoops = juce::jmax (1, optionOr ("--loops", "1").getIntValue());
+    settings.tailSeconds = juce::jmax (0.0, optionOr ("--tail", "2").getDoubleValue());
+    settings.numThreads = juce::jmax (0, optionOr ("--threads", "0").getIntValue());
+    const int bits = optionOr ("--bits", "24").getIntValue();
+
+    auto projectFile = juce::File::getCurrentWorkingDirectory().getChildFile (positional[0]);
+    auto outputFile = juce::File::getCurrentWorkingDirectory().getChildFile (positional[1]);
+
+    if (! projectFile.existsAsFile())
+    {
+        std::cerr << "Project not found: " << projectFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    OfflineRenderer renderer (settings);
+    if (! renderer.loadProjectFile (projectFile))
+    {
+        std::cerr << "Not a valid project: " << projectFile.getFullPathName() << "\n";
+        return 1;
+    }
+
+    std::atomic<bool> stemsOk { true };
+    if (args.containsOption ("--stems"))
+    {
+        auto stemDir = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--stems"));
+        stemDir.createDirectory();
+
+        // Stems are written on the worker that rendered them, in parallel with the other tracks
+        renderer.onStemRendered = [&] (int trackIndex, const juce::AudioBuffer<float>& stem) {
+            auto name = juce::String (trackIndex + 1).paddedLeft ('0', 2) + "_" + juce::File::createLegalFileName (renderer.getTrackName (trackIndex));
+            if (! OfflineRenderer::writeWav (stem, stemDir.getChildFile (name + ".wav"), settings.sampleRate, bits))
+                stemsOk = false;
+        };
+    }
+
+    const auto startTicks = juce::Time::getHighResolutionTicks();
+    renderer.render();
+
+    if (! OfflineRenderer::writeWav (renderer.getMaster(), outputFile, settings.sampleRate, bits) || ! stemsOk)
+    {
+        std::cerr << "Failed to write output\n";
+        return 1;
+    }
+
+    const double elapsed = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    std::cout << "Rendered " << renderer.getNumTracks() << " tracks, " << renderer.getRenderedSeconds() << " s of audio in "
+              << elapsed << " s (" << renderer.getRenderedSeconds() / juce::jmax (1.0e-9, elapsed) << "x real time)\n";
+    return 0;
+}
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <atomic>
+#include <thread>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+// Fork/join pool the audio thread uses to render independent tasks on several cores.
+// run() publishes a job with a single atomic store; the audio thread and the workers
+// then claim task indices lock-free until none are left. Workers spin briefly between
+// jobs and fall back to sleeping, so idle cores are not burned. run() never allocates.
+// It does take a lock to wake a worker that went to sleep: WaitableEvent::signal() locks the
+// event's mutex. Workers spin for well under a callback period, so between callbacks they are
+// usually asleep and run() takes that lock once per worker per block. The worker only holds
+// it for a few instructions as it enters or leaves wait(), so run() rarely has to wait for it.
+class RenderWorkerPool
+{
+public:
+    using TaskFunction = void (*) (void* context, int taskIndex);
+
+    RenderWorkerPool() = default;
+    ~RenderWorkerPool() { stop(); }
+
+    // Message Thread: (re)starts the pool with the given number of helper threads
+    void start (int numWorkers)
+    {
+        stop();
+        for (int i = 0; i < numWorkers; ++i)
+        {
+            auto* w = workers.add (new Worker (*this, i));
+            w->startThread (juce::Thread::Priority::highest);
+        }
+    }
+
+    // Message Thread
+    void stop()
+    {
+        for (auto* w : workers)
+            w->signalThreadShouldExit();
+        for (auto* w : workers)
+        {
+            w->wake.signal();
+            w->stopThread (2000);
+        }
+        workers.clear();
+    }
+
+    int getNumWorkers() const { return workers.size(); }
+
+    // Audio Thread: runs task(context, i) for every i in [0, numTasks) and returns when all are done.
+    // The calling thread takes part, so with no workers this is a plain loop.
+    void run (int numTasks, TaskFunction task, void* context)
+    {
+        jassert (numTasks < (1 << 16));
+        if (numTasks <= 0) return;
+
+        if (workers.size() == 0 || numTasks == 1)
+        {
+            for (int i = 0; i < numTasks; ++i)
+                task (context, i);
+            return;
+        }
+
+        jobTask.store (task, std::memory_order_relaxed);
+        jobContext.store (context, std::memory_order_relaxed);
+        remaining.store (numTasks, std::memory_order_relaxed);
+
+        const auto generation = (uint32_t) (claimState.load (std::memory_order_relaxed) >> 32) + 1;
+        claimState.store (pack (generation, numTasks, 0));
+
+        for (auto* w : workers)
+            if (w->sleeping.load())
+                w->wake.signal(); // The only lock run() takes; see the class comment
+
+        processTasks (generation);
+
+        // The last few tasks may still be running on other cores; they are short, so spin
+        while (remaining.load (std::memory_order_acquire) > 0)
+            cpuRelax();
+    }
+
+    static void cpuRelax() noexcept
+    {
+       #if JUCE_INTEL
+        _mm_pause();
+       #else
+        std::this_thread::yield();
+       #endif
+    }
+
+private:
+    // Claim state: generation (32 bits) | task count (16 bits) | next task (16 bits).
+    // Packing the generation in means a worker that is late for one job can never claim
+    // a task of the next one.
+    static uint64_t pack (uint32_t generation, int numTasks, int next)
+    {
+        return ((uint64_t) generation << 32) | ((uint64_t) (uint32_t) numTasks << 16) | (uint64_t) (uint32_t) next;
+    }
+
+    bool claim (uint32_t generation, int& taskIndex)
+    {
+        auto state = claimState.load (std::memory_order_acquire);
+        for (;;)
+        {
+            const auto numTasks = (int) ((state >> 16) & 0xffff);
+            const auto next = (int) (state & 0xffff);
+            if ((uint32_t) (state >> 32) != generation || next >= numTasks)
+                return false;
+
+            if (claimState.compare_exchange_weak (state, state + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            {
+                taskIndex = next;
+                return true;
+            }
+        }
+    }
+
+    void processTasks (uint32_t generation)
+    {
+        int taskIndex;
+        while (claim (generation, taskIndex))
+        {
+            jobTask.load (std::memory_order_relaxed) (jobContext.load (std::memory_order_relaxed), taskIndex);
+            remaining.fetch_sub (1, std::memory_order_release);
+        }
+    }
+
+    class Worker : public juce::Thread
+    {
+    public:
+        Worker (RenderWorkerPool& p, int index)
+            : juce::Thread ("Render Worker " + juce::String (index + 1)), pool (p) {}
+
+        void run() override
+        {
+            auto seen = (uint32_t) (pool.claimState.load() >> 32);
+
+            while (! threadShouldExit())
+            {
+                const auto generation = waitForJob (seen);
+                if (generation == seen) continue; // Woken to exit
+
+                seen = generation;
+                pool.processTasks (generation);
+            }
+        }
+
+        juce::WaitableEvent wake;
+        std::atomic<bool> sleeping { false };
+
+    private:
+        uint32_t waitForJob (uint32_t seen)
+        {
+            // Spin first: a job usually follows within microseconds while the callback is busy
+            for (int spin = 0; spin < spinIterations; ++spin)
+            {
+                const auto generation = (uint32_t) (pool.claimState.load (std::memory_order_acquire) >> 32);
+                if (generation != seen) return generation;
+                cpuRelax();
+            }
+
+            // Then sleep. Setting the flag before re-checking pairs with run() reading it after
+            // the new job is published, so a wake-up can never be missed.
+            sleeping.store (true);
+            auto generation = (uint32_t) (pool.claimState.load() >> 32);
+            if (generation == seen && ! threadShouldExit())
+            {
+                wake.wait (100.0);
+                generation = (uint32_t) (pool.claimState.load (std::memory_order_acquire) >> 32);
+            }
+            sleeping.store (false);
+            return generation;
+        }
+
+        static constexpr int spinIterations = 2000;
+        RenderWorkerPool& pool;
+    };
+
+    juce::OwnedArray<Worker> workers;
+
+    std::atomic<uint64_t> claimState { 0 };
+    std::atomic<int> remaining { 0 };
+    std::atomic<TaskFunction> jobTask { nullptr };
+    std::atomic<void*> jobContext { nullptr };
+
+    JUCE_DECLARE_NON_COPYABLE (RenderWorkerPool)
+};
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// One sample file as the sampler plays it. The first headFrames are decoded into RAM, so a note
+// can start at once; the rest is read by the SampleStreamer, from a memory map of the file where
+// the format allows it. Immutable once loaded.
+class Sample
+{
+public:
+    static constexpr int headFrames = 32768; // Covers the streamer's first fill, even pitched up three octaves
+
+    // Message Thread: nullptr if the file is not a readable audio file
+    static std::shared_ptr<Sample> load (const juce::File& file, juce::AudioFormatManager& formats)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader;
+
+        if (auto* format = formats.findFormatForFileExtension (file.getFileExtension()))
+            if (std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped { format->createMemoryMappedReader (file) })
+                if (mapped->mapEntireFile())
+                    reader = std::move (mapped);
+
+        if (reader == nullptr)
+            reader.reset (formats.createReaderFor (file));
+        if (reader == nullptr || reader->lengthInSamples <= 0)
+            return nullptr;
+
+        auto sample = std::shared_ptr<Sample> (new Sample());
+        sample->file = file;
+        sample->sampleRate = reader->sampleRate;
+        sample->numChannels = (int) juce::jlimit (1u, 2u, reader->numChannels);
+        sample->length = reader->lengthInSamples;
+
+        const int numHead = (int) juce::jmin ((juce::int64) headFrames, sample->length);
+        sample->head.setSize (sample->numChannels, numHead);
+        reader->read (&sample->head, 0, numHead, 0, true, sample->numChannels > 1);
+
+        sample->reader = std::move (reader);
+        return sample;
+    }
+
+    const juce::File& getFile() const { return file; }
+    double getSampleRate() const { return sampleRate; }
+    int getNumChannels() const { return numChannels; }
+    juce::int64 getLength() const { return length; }
+
+    // Any thread: the decoded start of the sample
+    const juce::AudioBuffer<float>& getHead() const { return head; }
+    int getNumHeadFrames() const { return head.getNumSamples(); }
+
+    // RAM held by the sample; the mapped file is paged in and out by the OS
+    size_t getMemorySize() const { return (size_t) head.getNumChannels() * (size_t) head.getNumSamples() * sizeof (float); }
+
+private:
+    friend class SampleStreamer;
+
+    Sample() = default;
+
+    // Streamer thread only: decodes frames [start, start + numFrames) into dest
+    bool read (float* const* dest, juce::int64 start, int numFrames) const
+    {
+        return reader->read (dest, numChannels, start, numFrames);
+    }
+
+    juce::File file;
+    double sampleRate = 44100.0;
+    int numChannels = 1;
+    juce::int64 length = 0;
+    juce::AudioBuffer<float> head;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+
+    JUCE_DECLARE_NON_COPYABLE (Sample)
+};
+
+// Keeps every playing sampler voice's prefetch ring ahead of its playback position, on one
+// background thread shared by all tracks. The audio thread never reads a file: it starts and
+// stops a Stream and takes frames out of its ring. A Stream that has not caught up counts an
+// underrun and the voice plays silence until it has.
+class SampleStreamer : private juce::Thread
+{
+public:
+    // One voice's ring. Restarting it bumps a generation number, so frames the streamer was
+    // still writing for the previous note are never mistaken for the new one's.
+    class Stream
+    {
+    public:
+        static constexpr int ringFrames = 16384;
+
+        Stream() : ring (2, ringFrames) {}
+
+        // Audio Thread: stream sample from frame firstFrame on
+        void start (const Sample* sample, juce::int64 firstFrame)
+        {
+            requestSample.store (sample, std::memory_order_relaxed);
+            requestStart.store (firstFrame, std::memory_order_relaxed);
+            consumed.store (firstFrame, std::memory_order_relaxed);
+            generation = (generation + 1) & genMask;
+            requestGen.store (generation, std::memory_order_release);
+        }
+
+        // Audio Thread
+        void stop() { start (nullptr, 0); }
+
+        // Audio Thread: copies frames [from, from + numFrames) into dest, false if the streamer is not that far yet
+        bool fetch (juce::int64 from, int numFrames, float* const* dest, int numChannels) const
+        {
+            const auto p = progress.load (std::memory_order_acquire);
+            if ((uint32_t) (p >> 48) != generation || from + numFrames > (juce::int64) (p & endMask))
+                return false;
+
+            const int pos = (int) (from % ringFrames);
+            const int first = juce::jmin (numFrames, ringFrames - pos);
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                juce::FloatVectorOperations::copy (dest[channel], ring.getReadPointer (channel, pos), first);
+                juce::FloatVectorOperations::copy (dest[channel] + first, ring.getReadPointer (channel), numFrames - first);
+            }
+            return true;
+        }
+
+        // Audio Thread: frames before this are no longer needed, so the streamer may overwrite them
+        void release (juce::int64 upTo)
+        {
+            if (upTo > consumed.load (std::memory_order_relaxed))
+                consumed.store (upTo, std::memory_order_release);
+        }
+
+    private:
+        friend class SampleStreamer;
+
+        static constexpr uint32_t genMask = 0xffff;
+        static constexpr uint64_t endMask = (1ull << 48) - 1;
+
+        // Written by the audio thread
+        std::atomic<const Sample*> requestSample { nullptr };
+        std::atomic<juce::int64> requestStart { 0 }, consumed { 0 };
+        std::atomic<uint32_t> requestGen { 0 };
+        uint32_t generation = 0;
+
+        // Written by the streamer: generation << 48 | first frame not yet in the ring
+        std::atomic<uint64_t> progress { 0 };
+        uint32_t servedGen = 0;
+        const Sample* sample = nullptr;
+        juce::int64 end = 0;
+
+        juce::AudioBuffer<float> ring;
+
+        JUCE_DECLARE_NON_COPYABLE (Stream)
+    };
+
+    SampleStreamer() : juce::Thread ("SampleStreamer") { startThread(); }
+    ~SampleStreamer() override { stopThread (2000); }
+
+    // Message Thread: the streamer only serves streams while they are registered
+    void add (Stream& stream)
+    {
+        std::lock_guard<std::mutex> lock (streamsMutex);
+        streams.push_back (&stream);
+    }
+
+    void remove (Stream& stream)
+    {
+        std::lock_guard<std::mutex> lock (streamsMutex); // Waits out a pass that may be writing to it
+        streams.erase (std::remove (streams.begin(), streams.end(), &stream), streams.end());
+    }
+
+    // Audio Thread
+    void countUnderrun() { underruns.fetch_add (1, std::memory_order_relaxed); }
+    uint64_t getNumUnderruns() const { return underruns.load(); }
+
+private:
+    static constexpr int readFrames = 4096; // Per read; smaller gaps wait for the next pass
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            {
+                std::lock_guard<std::mutex> lock (streamsMutex); // Message thread only ever waits on this, never the audio thread
+                for (auto* stream : streams)
+                    serve (*stream);
+            }
+            wait (2);
+        }
+    }
+
+    void serve (Stream& s)
+    {
+        const auto gen = s.requestGen.load (std::memory_order_acquire);
+        if (gen != s.servedGen)
+        {
+            const auto* sample = s.requestSample.load (std::memory_order_relaxed);
+            const auto start = s.requestStart.load (std::memory_order_relaxed);
+            if (s.requestGen.load (std::memory_order_acquire) != gen) return; // Restarted while reading it; next pass
+
+            s.servedGen = gen;
+            s.sample = sample;
+            s.end = start;
+            publish (s);
+        }
+
+        if (s.sample == nullptr) return;
+
+        for (;;)
+        {
+            const auto free = Stream::ringFrames - (s.end - s.consumed.load (std::memory_order_acquire));
+            const auto remaining = s.sample->getLength() - s.end;
+            const int pos = (int) (s.end % Stream::ringFrames);
+            const int n = (int) juce::jmin ((juce::int64) (Stream::ringFrames - pos), free, remaining);
+            if (n <= 0 || (n < readFrames && n < remaining && pos + n < Stream::ringFrames)) return;
+
+            const int count = juce::jmin (n, readFrames);
+            float* dest[2] = { s.ring.getWritePointer (0, pos), s.ring.getWritePointer (1, pos) };
+            if (! s.sample->read (dest, s.end, count))
+                for (auto* channel : dest)
+                    juce::FloatVectorOperations::clear (channel, count); // Plays as silence rather than stalling the voice
+
+            s.end += count;
+            publish (s);
+
+            if (s.requestGen.load (std::memory_order_relaxed) != s.servedGen) return; // Restarted: serve the new note next pass
+        }
+    }
+
+    static void publish (Stream& s)
+    {
+        s.progress.store (((uint64_t) s.servedGen << 48) | ((uint64_t) s.end & Stream::endMask), std::memory_order_release);
+    }
+
+    std::mutex streamsMutex;
+    std::vector<Stream*> streams;
+    std::atomic<uint64_t> underruns { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (SampleStreamer)
+};
+
+// Samples shared by every sampler on every track. A file is loaded once however many zones or
+// instruments use it, and two files with the same content share one Sample. A file edited on
+// disk since it was loaded is loaded again. Samples no
+// instrument holds stay cached for quick reloading until the pool is over its memory budget,
+// then go least recently used first.
+class SamplePool
+{
+public:
+    struct Stats
+    {
+        int numSamples = 0;
+        size_t memoryUsed = 0, memoryBudget = 0;
+        uint64_t hits = 0, misses = 0, underruns = 0;
+    };
+
+    SamplePool() { formats.registerBasicFormats(); }
+
+    // Message Thread
+    void setMemoryBudget (size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock (poolMutex);
+        budget = bytes;
+        evict();
+    }
+
+    // Message Thread: the shared Sample for file, nullptr if it cannot be read
+    std::shared_ptr<const Sample> get (const juce::File& file)
+    {
+        const auto key = fingerprint (file);
+        if (key == 0) return nullptr;
+
+        const auto modified = file.getLastModificationTime();
+
+        std::lock_guard<std::mutex> lock (poolMutex);
+
+        // The fingerprint only narrows it down: a hit is the same unedited file, or another file
+        // whose every byte matches
+        for (auto [found, last] = index.equal_range (key); found != last; ++found)
+        {
+            const auto& entry = *found->second;
+            const bool sameFile = entry.file == file;
+            if (sameFile ? entry.modified != modified
+                         : entry.file.getLastModificationTime() != entry.modified || ! haveSameContent (entry.file, file))
+                continue; // Edited since it was loaded; eviction drops it once nothing holds it
+
+            lru.splice (lru.end(), lru, found->second);
+            ++hits;
+            return entry.sample;
+        }
+
+        auto sample = Sample::load (file, formats);
+        if (sample == nullptr) return nullptr;
+
+        ++misses;
+        used += sample->getMemorySize();
+        index.emplace (key, lru.insert (lru.end(), { key, file, modified, sample }));
+        evict();
+        return sample;
+    }
+
+    Stats getStats() const
+    {
+        std::lock_guard<std::mutex> lock (poolMutex);
+        return { (int) lru.size(), used, budget, hits, misses, streamer.getNumUnderruns() };
+    }
+
+    SampleStreamer& getStreamer() { return streamer; }
+
+private:
+    struct Entry
+    {
+        uint64_t key;
+        juce::File file;
+        juce::Time modified; // When it was loaded
+        std::shared_ptr<const Sample> sample;
+    };
+
+    static constexpr int fingerprintBytes = 65536;
+
+    static bool haveSameContent (const juce::File& a, const juce::File& b)
+    {
+        juce::FileInputStream inA (a), inB (b);
+        if (! inA.openedOk() || ! inB.openedOk() || inA.getTotalLength() != inB.getTotalLength())
+            return false;
+
+        juce::HeapBlock<char> blockA ((size_t) fingerprintBytes), blockB ((size_t) fingerprintBytes);
+        for (;;)
+        {
+            const int numA = inA.read (blockA.get(), fingerprintBytes);
+            const int numB = inB.read (blockB.get(), fingerprintBytes);
+            if (numA != numB || std::memcmp (blockA.get(), blockB.get(), (size_t) juce::jmax (0, numA)) != 0)
+                return false;
+            if (numA <= 0)
+                return true;
+        }
+    }
+
+    // FNV-1a over the size and the first and last 64 KB: tells files apart without reading gigabytes
+    static uint64_t fingerprint (const juce::File& file)
+    {
+        juce::FileInputStream in (file);
+        if (! in.openedOk()) return 0;
+
+        uint64_t hash = 14695981039346656037ull;
+        auto mix = [&hash] (const void* data, size_t size) {
+            for (size_t i = 0; i < size; ++i)
+                hash = (hash ^ static_cast<const juce::uint8*> (data)[i]) * 1099511628211ull;
+        };
+
+        const auto size = in.getTotalLength();
+        mix (&size, sizeof (size));
+
+        juce::HeapBlock<char> block ((size_t) fingerprintBytes);
+        mix (block.get(), (size_t) juce::jmax (0, in.read (block.get(), fingerprintBytes)));
+        if (size > fingerprintBytes && in.setPosition (juce::jmax ((juce::int64) fingerprintBytes, size - fingerprintBytes)))
+            mix (block.get(), (size_t) juce::jmax (0, in.read (block.get(), fingerprintBytes)));
+
+        return hash == 0 ? 1 : hash;
+    }
+
+    // Oldest first, skipping samples an instrument still holds
+    void evict()
+    {
+        for (auto it = lru.begin(); used > budget && it != lru.end();)
+        {
+            if (it->sample.use_count() > 1) { ++it; continue; }
+            used -= it->sample->getMemorySize();
+            for (auto [found, last] = index.equal_range (it->key); found != last; ++found)
+            {
+                if (found->second == it)
+                {
+                    index.erase (found);
+                    break;
+                }
+            }
+            it = lru.erase (it);
+        }
+    }
+
+    juce::AudioFormatManager formats;
+    SampleStreamer streamer;
+
+    mutable std::mutex poolMutex;
+    std::list<Entry> lru; // Least recently used first
+    std::multimap<uint64_t, std::list<Entry>::iterator> index; // Files that fingerprint alike each have their own entry
+    size_t used = 0, budget = (size_t) 512 << 20;
+    uint64_t hits = 0, misses = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (SamplePool)
+};
@@ -0,0 +1,361 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SamplePool.h"
+#include "SynthEngine.h"
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// A multi-zone sampler. Each zone maps a key and velocity range to one sample, played back
+// pitched from its root key; overlapping zones layer. Samples come from the shared SamplePool,
+// so a file is in memory once however many zones and tracks use it, and everything past a
+// sample's head streams from disk while the note plays.
+class SamplerProcessor : public juce::AudioProcessor
+{
+public:
+    struct Zone
+    {
+        std::shared_ptr<const Sample> sample;
+        int rootKey = 60;
+        int loKey = 0, hiKey = 127;
+        int loVelocity = 1, hiVelocity = 127;
+        float gain = 1.0f;
+    };
+
+    static constexpr int maxVoices = 32;
+
+    explicit SamplerProcessor (SamplePool& samplePool)
+        : AudioProcessor (BusesProperties().withOutput ("Output", juce::AudioChannelSet::stereo(), true)),
+          pool (samplePool)
+    {
+        for (auto& voice : voices)
+            pool.getStreamer().add (voice.stream);
+    }
+
+    ~SamplerProcessor() override
+    {
+        for (auto& voice : voices)
+            pool.getStreamer().remove (voice.stream);
+    }
+
+    // Message Thread, before the sampler is handed to a track
+    void addZone (Zone zone)
+    {
+        if (zone.sample != nullptr)
+            zones.push_back (std::move (zone));
+    }
+
+    // Message Thread: a sampler for a mapping file, nullptr with error set if it cannot be used.
+    //   { "name": "Piano", "zones": [ { "file": "C4.wav", "root": 60, "lo": 58, "hi": 62, "vlo": 1, "vhi": 127, "gain": 1.0 } ] }
+    // Sample paths are relative to the mapping file.
+    static std::unique_ptr<SamplerProcessor> loadMapping (const juce::File& mappingFile, SamplePool& samplePool, juce::String& error)
+    {
+        const auto json = juce::JSON::parse (mappingFile);
+        const auto zonesVar = json.getProperty ("zones", {});
+        const auto* zoneList = zonesVar.getArray();
+        if (zoneList == nullptr)
+        {
+            error = "No zones in " + mappingFile.getFileName();
+            return nullptr;
+        }
+
+        auto sampler = std::make_unique<SamplerProcessor> (samplePool);
+        sampler->name = json.getProperty ("name", mappingFile.getFileNameWithoutExtension()).toString();
+
+        for (const auto& z : *zoneList)
+        {
+            const auto file = mappingFile.getSiblingFile (z.getProperty ("file", "").toString());
+            Zone zone;
+            zone.sample = samplePool.get (file);
+            if (zone.sample == nullptr)
+            {
+                error = "Cannot read " + file.getFullPathName();
+                return nullptr;
+            }
+
+            zone.rootKey    = juce::jlimit (0, 127, (int) z.getProperty ("root", 60));
+            zone.loKey      = juce::jlimit (0, 127, (int) z.getProperty ("lo", zone.rootKey));
+            zone.hiKey      = juce::jlimit (0, 127, (int) z.getProperty ("hi", zone.rootKey));
+            zone.loVelocity = juce::jlimit (1, 127, (int) z.getProperty ("vlo", 1));
+            zone.hiVelocity = juce::jlimit (1, 127, (int) z.getProperty ("vhi", 127));
+            zone.gain       = juce::jlimit (0.0f, 4.0f, (float) z.getProperty ("gain", 1.0));
+            sampler->addZone (std::move (zone));
+        }
+
+        if (sampler->zones.empty())
+        {
+            error = "No zones in " + mappingFile.getFileName();
+            return nullptr;
+        }
+        return sampler;
+    }
+
+    void prepareToPlay (double sampleRate, int) override
+    {
+        outputRate = sampleRate;
+        releaseStep = 1.0f / (float) juce::jmax (1.0, sampleRate * releaseSeconds);
+        for (auto& voice : voices)
+            stopVoice (voice);
+    }
+
+    void releaseResources() override {}
+
+    // Renders between MIDI events so every note starts and stops on its exact sample
+    void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
+    {
+        const int numSamples = buffer.getNumSamples();
+        int position = 0;
+
+        buffer.clear();
+        if (cutRequested.exchange (false))
+            for (auto& voice : voices)
+                stopVoice (voice);
+
+        for (const auto metadata : midiMessages)
+        {
+            const int eventPosition = juce::jlimit (0, numSamples, metadata.samplePosition);
+            if (eventPosition > position)
+            {
+                renderRange (buffer, position, eventPosition);
+                position = eventPosition;
+            }
+            handleMidiEvent (metadata.getMessage());
+        }
+
+        if (position < numSamples)
+            renderRange (buffer, position, numSamples);
+    }
+
+    // Any thread: voices are cut at the start of the next block
+    void allNotesOff() { cutRequested.store (true); }
+
+    int getNumZones() const { return (int) zones.size(); }
+
+    // Message Thread: another sampler with the same zones, sharing their samples
+    std::unique_ptr<SamplerProcessor> createCopy() const
+    {
+        auto copy = std::make_unique<SamplerProcessor> (pool);
+        copy->zones = zones;
+        copy->name = name;
+        return copy;
+    }
+
+    // Boilerplate
+    const juce::String getName() const override { return name; }
+    bool acceptsMidi() const override { return true; }
+    bool producesMidi() const override { return false; }
+    double getTailLengthSeconds() const override { return releaseSeconds; }
+    int getNumPrograms() override { return 1; }
+    int getCurrentProgram() override { return 0; }
+    void setCurrentProgram (int) override {}
+    const juce::String getProgramName (int) override { return {}; }
+    void changeProgramName (int, const juce::String&) override {}
+    bool hasEditor() const override { return false; }
+    juce::AudioProcessorEditor* createEditor() override { return nullptr; }
+    void getStateInformation (juce::MemoryBlock&) override {}
+    void setStateInformation (const void*, int) override {}
+
+private:
+    using Vec = Oscillator::Vec;
+    static constexpr int vecSize = Oscillator::vecSize;
+
+    static constexpr double releaseSeconds = 0.25;
+    static constexpr int chunkSize = 128;       // Output samples rendered per gather
+    static constexpr double maxIncrement = 8.0; // Three octaves up at equal rates; higher notes stop rising
+    static constexpr int maxSourceFrames = (int) (chunkSize * maxIncrement) + 4;
+
+    struct Voice
+    {
+        const Zone* zone = nullptr; // nullptr while free
+        int note = -1;
+        double position = 0.0;      // In source frames
+        double increment = 1.0;
+        float level = 0.0f;
+        float envelope = 1.0f;
+        bool releasing = false;
+        uint32_t age = 0;
+        SampleStreamer::Stream stream;
+    };
+
+    void handleMidiEvent (const juce::MidiMessage& m)
+    {
+        if (m.isNoteOn())                                noteOn (m.getNoteNumber(), m.getVelocity());
+        else if (m.isNoteOff())                          noteOff (m.getNoteNumber());
+        else if (m.isAllNotesOff() || m.isAllSoundOff()) for (auto& voice : voices) voice.releasing = voice.zone != nullptr;
+    }
+
+    void noteOn (int note, int velocity)
+    {
+        for (const auto& zone : zones)
+        {
+            if (note < zone.loKey || note > zone.hiKey || velocity < zone.loVelocity || velocity > zone.hiVelocity)
+                continue;
+
+            auto& voice = allocateVoice();
+            const auto& sample = *zone.sample;
+            voice.zone = &zone;
+            voice.note = note;
+            voice.position = 0.0;
+            voice.increment = juce::jmin (maxIncrement, std::pow (2.0, (note - zone.rootKey) / 12.0) * sample.getSampleRate() / outputRate);
+            voice.level = zone.gain * (float) velocity / 127.0f;
+            voice.envelope = 1.0f;
+            voice.releasing = false;
+            voice.age = ++noteCounter;
+
+            if (sample.getLength() > sample.getNumHeadFrames())
+                voice.stream.start (&sample, sample.getNumHeadFrames());
+        }
+    }
+
+    void noteOff (int note)
+    {
+        for (auto& voice : voices)
+            if (voice.zone != nullptr && voice.note == note)
+                voice.releasing = true;
+    }
+
+    // A free voice, or the oldest one, releasing ones first
+    Voice& allocateVoice()
+    {
+        Voice* oldest = nullptr;
+        for (auto& voice : voices)
+        {
+            if (voice.zone == nullptr) return voice;
+            if (oldest == nullptr || (voice.releasing && ! oldest->releasing)
+                || (voice.releasing == oldest->releasing && voice.age < oldest->age))
+                oldest = &voice;
+        }
+        stopVoice (*oldest);
+        return *oldest;
+    }
+
+    void stopVoice (Voice& voice)
+    {
+        if (voice.zone != nullptr && voice.zone->sample->getLength() > voice.zone->sample->getNumHeadFrames())
+            voice.stream.stop();
+        voice.zone = nullptr;
+        voice.note = -1;
+    }
+
+    void renderRange (juce::AudioBuffer<float>& buffer, int start, int end)
+    {
+        for (auto& voice : voices)
+            for (int pos = start; voice.zone != nullptr && pos < end; pos += chunkSize)
+                renderVoice (voice, buffer, pos, juce::jmin (chunkSize, end - pos));
+    }
+
+    // Gathers the source frames the chunk reads into contiguous scratch, then interpolates them
+    void renderVoice (Voice& voice, juce::AudioBuffer<float>& buffer, int start, int numSamples)
+    {
+        const auto& sample = *voice.zone->sample;
+        const int numChannels = sample.getNumChannels();
+
+        const auto first = (juce::int64) voice.position - 1;
+        const auto last = (juce::int64) (voice.position + (numSamples - 1) * voice.increment) + 2;
+        const int count = (int) (last - first + 1);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            juce::FloatVectorOperations::clear (source[channel], count);
+
+        // Head frames from memory, the rest from the stream
+        const auto& head = sample.getHead();
+        const auto headEnd = juce::jmin (last + 1, (juce::int64) sample.getNumHeadFrames());
+        if (headEnd > juce::jmax ((juce::int64) 0, first))
+        {
+            const auto from = juce::jmax ((juce::int64) 0, first);
+            for (int channel = 0; channel < numChannels; ++channel)
+                juce::FloatVectorOperations::copy (source[channel] + (from - first), head.getReadPointer (channel, (int) from), (int) (headEnd - from));
+        }
+
+        const auto streamFrom = juce::jmax (first, (juce::int64) sample.getNumHeadFrames());
+        const auto streamEnd = juce::jmin (last + 1, sample.getLength());
+        if (streamEnd > streamFrom)
+        {
+            float* dest[2] = { source[0] + (streamFrom - first), source[1] + (streamFrom - first) };
+            bool fetched = voice.stream.fetch (streamFrom, (int) (streamEnd - streamFrom), dest, numChannels);
+
+            // Rendering offline (a freeze), waiting for the streamer costs time, not a dropout
+            for (int waited = 0; ! fetched && isNonRealtime() && waited < 1000; ++waited)
+            {
+                juce::Thread::sleep (1);
+                fetched = voice.stream.fetch (streamFrom, (int) (streamEnd - streamFrom), dest, numChannels);
+            }
+
+            if (! fetched)
+            {
+                pool.getStreamer().countUnderrun();
+                for (int channel = 0; channel < numChannels; ++channel)
+                    juce::FloatVectorOperations::clear (source[channel], count);
+            }
+        }
+
+        // Envelope: flat, then a linear release
+        for (int i = 0; i < numSamples; ++i)
+        {
+            gains[i] = voice.level * voice.envelope;
+            if (voice.releasing) voice.envelope = juce::jmax (0.0f, voice.envelope - releaseStep);
+        }
+
+        const double offset = voice.position - (double) first;
+        for (int channel = 0; channel < juce::jmin (2, buffer.getNumChannels()); ++channel)
+        {
+            hermite (source[juce::jmin (channel, numChannels - 1)], out, numSamples, offset, voice.increment);
+            juce::FloatVectorOperations::multiply (out, gains, numSamples);
+            buffer.addFrom (channel, start, out, numSamples);
+        }
+
+        voice.position += numSamples * voice.increment;
+        voice.stream.release ((juce::int64) voice.position - 1);
+
+        if ((juce::int64) voice.position >= sample.getLength() || (voice.releasing && voice.envelope <= 0.0f))
+            stopVoice (voice);
+    }
+
+    // 4-point, 3rd-order Hermite at x = offset + i * increment for i < numSamples. Taps are
+    // gathered per lane, then the polynomial runs a register of outputs at a time.
+    static void hermite (const float* src, float* dest, int numSamples, double offset, double increment)
+    {
+        alignas (64) float xm1[vecSize], x0[vecSize], x1[vecSize], x2[vecSize], frac[vecSize];
+        const auto half = Vec::expand (0.5f), onePointFive = Vec::expand (1.5f), two = Vec::expand (2.0f), twoPointFive = Vec::expand (2.5f);
+
+        for (int i = 0; i < numSamples; i += vecSize)
+        {
+            for (int lane = 0; lane < vecSize; ++lane)
+            {
+                const double x = offset + juce::jmin (i + lane, numSamples - 1) * increment;
+                const int k = (int) x;
+                frac[lane] = (float) (x - k);
+                xm1[lane] = src[k - 1];
+                x0[lane] = src[k];
+                x1[lane] = src[k + 1];
+                x2[lane] = src[k + 2];
+            }
+
+            const auto ym1 = Vec::fromRawArray (xm1), y0 = Vec::fromRawArray (x0), y1 = Vec::fromRawArray (x1), y2 = Vec::fromRawArray (x2);
+            const auto f = Vec::fromRawArray (frac);
+            const auto c1 = half * (y1 - ym1);
+            const auto c2 = ym1 - twoPointFive * y0 + two * y1 - half * y2;
+            const auto c3 = half * (y2 - ym1) + onePointFive * (y0 - y1);
+            (((c3 * f + c2) * f + c1) * f + y0).copyToRawArray (dest + i);
+        }
+    }
+
+    SamplePool& pool;
+    std::vector<Zone> zones; // Fixed once the sampler is playing
+    juce::String name { "Sampler" };
+
+    // Audio Thread
+    Voice voices[maxVoices];
+    double outputRate = 44100.0;
+    float releaseStep = 0.001f;
+    uint32_t noteCounter = 0;
+    std::atomic<bool> cutRequested { false };
+
+    alignas (64) float source[2][maxSourceFrames];
+    alignas (64) float out[chunkSize];
+    alignas (64) float gains[chunkSize];
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SamplerProcessor)
+};
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectModel.h"
+
+// Turns published notes into sample-stamped MIDI, one block at a time.
+// Shared by the live audio callback and the offline renderer.
+class Sequencer
+{
+public:
+    // The beats one block covers, split in two when it crosses the loop end
+    struct BlockWindow
+    {
+        // loop must be the region the transport advanced through for this block
+        BlockWindow (double beatBefore, double beatAfter, const Transport& transport, const LoopRegion& loop, int blockSamples, double sampleRate)
+            : loopLength (loop.getLength()),
+              beatsPerSample (transport.getBeatsPerSample (sampleRate)),
+              numSamples (blockSamples)
+        {
+            if (beatAfter >= beatBefore) {
+                segments[numSegments++] = { beatBefore, beatAfter, 0.0 };
+            } else {
+                segments[numSegments++] = { beatBefore, loop.end, 0.0 };
+                segments[numSegments++] = { loop.start, beatAfter, (loop.end - beatBefore) / beatsPerSample };
+            }
+        }
+
+        // For a private clock whose region nothing else changes
+        BlockWindow (double beatBefore, double beatAfter, const Transport& transport, int blockSamples, double sampleRate)
+            : BlockWindow (beatBefore, beatAfter, transport, transport.getLoopRegion(), blockSamples, sampleRate)
+        {
+        }
+
+        struct Segment { double from, to, firstSample; };
+
+        int toSampleOffset (const Segment& seg, double beat) const
+        {
+            return juce::jlimit (0, numSamples - 1, (int) (seg.firstSample + (beat - seg.from) / beatsPerSample));
+        }
+
+        Segment segments[2];
+        int numSegments = 0;
+        double loopLength;
+        double beatsPerSample;
+        int numSamples;
+    };
+
+    // Audio Thread: queues one track's note events for the block, O(log n + k)
+    static void scheduleTrack (const TrackNotes& notes, const BlockWindow& window, juce::MidiBuffer& midi)
+    {
+        // Note-offs first, so a pitch retriggered on the same sample is released before it restarts
+        for (int s = 0; s < window.numSegments; ++s)
+        {
+            const auto& seg = window.segments[s];
+            notes.forEachNoteOff (seg.from, seg.to, [&] (const NoteOff& off) {
+                midi.addEvent (juce::MidiMessage::noteOff (1, off.note), window.toSampleOffset (seg, off.beat));
+            });
+
+            // Notes held across the loop end are released on the next pass
+            notes.forEachNoteOff (seg.from + window.loopLength, seg.to + window.loopLength, [&] (const NoteOff& off) {
+                midi.addEvent (juce::MidiMessage::noteOff (1, off.note), window.toSampleOffset (seg, off.beat - window.loopLength));
+            });
+        }
+
+        for (int s = 0; s < window.numSegments; ++s)
+        {
+            const auto& seg = window.segments[s];
+            notes.forEachNoteOn (seg.from, seg.to, [&] (const NoteEvent& note) {
+                midi.addEvent (juce::MidiMessage::noteOn (1, note.note, note.velocity), window.toSampleOffset (seg, note.startBeat));
+            });
+        }
+    }
+};
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// A float parameter set from the message thread and used on the audio thread.
+// The message thread only stores a target in an atomic. The audio thread picks the
+// target up once per block and ramps towards it, so a change can never tear and never
+// lands as a step. Linear suits gains and pan, Multiplicative suits frequencies.
+template <typename SmoothingType = juce::ValueSmoothingTypes::Linear>
+class SmoothedParameter
+{
+public:
+    explicit SmoothedParameter (float initialValue) : target (initialValue)
+    {
+        smoothed.setCurrentAndTargetValue (initialValue);
+    }
+
+    // Message Thread
+    void set (float newValue) { target.store (newValue, std::memory_order_relaxed); }
+    float get() const { return target.load (std::memory_order_relaxed); }
+
+    // Jumps to the latest target, so a freshly prepared processor does not sweep in from a stale value
+    void prepare (double sampleRate, double rampSeconds)
+    {
+        smoothed.reset (sampleRate, rampSeconds);
+        smoothed.setCurrentAndTargetValue (get());
+    }
+
+    // Audio Thread: call at the start of each block
+    void beginBlock() { smoothed.setTargetValue (get()); }
+
+    // Audio Thread
+    float getCurrent() const { return smoothed.getCurrentValue(); }
+    bool isSmoothing() const { return smoothed.isSmoothing(); }
+    float skip (int numSamples) { return smoothed.skip (numSamples); }
+
+private:
+    std::atomic<float> target;
+    juce::SmoothedValue<float, SmoothingType> smoothed;
+
+    JUCE_DECLARE_NON_COPYABLE (SmoothedParameter)
+};
@@ -1,102 +1,71 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "Wavetable.h"
 
-// A simple Synthesizer Voice
-class SynthVoice : public juce::SynthesiserVoice
+// Lowpass with the same topology-preserving-transform structure as juce::dsp::StateVariableTPTFilter,
+// minus its per-sample filter-type switch. Coefficients change per block, never per sample.
+struct SvfLowpass
 {
-public:
-    SynthVoice() {}
+    void setSampleRate (double newSampleRate) { sampleRate = newSampleRate; update(); }
 
-    bool canPlaySound (juce::SynthesiserSound* sound) override { return dynamic_cast<juce::SynthesiserSound*> (sound) != nullptr; }
-
-    void startNote (int midiNoteNumber, float velocity, juce::SynthesiserSound*, int) override
+    void setParameters (float newCutoff, float newResonance)
     {
-        level = velocity * 0.25f;
-        auto cyclesPerSample = juce::MidiMessage::getMidiNoteInHertz (midiNoteNumber) / getSampleRate();
-        angleDelta = cyclesPerSample * 2.0 * juce::MathConstants<double>::pi;
-        currentAngle = 0.0;
-        adsr.noteOn();
+        cutoff = newCutoff;
+        resonance = newResonance;
+        update();
     }
 
-    void stopNote (float, bool allowTailOff) override
-    {
-        adsr.noteOff();
-        if (!allowTailOff) clearCurrentNote();
-    }
+    void reset() { s1 = s2 = 0.0f; }
 
-    void pitchWheelMoved (int) override {}
-    void controllerMoved (int, int) override {}
+    // True once the ringing left in the state is below threshold, so silence in means silence out
+    bool isSettled (float threshold) const { return std::abs (s1) < threshold && std::abs (s2) < threshold; }
 
-    void renderNextBlock (juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples) override
+    void process (float* samples, int numSamples)
     {
-        if (!adsr.isActive()) {
-            clearCurrentNote();
-            return;
-        }
-
-        for (int sample = 0; sample < numSamples; ++sample)
+        float ls1 = s1, ls2 = s2;
+        for (int i = 0; i < numSamples; ++i)
         {
-            auto envelopeValue = adsr.getNextSample();
-            float rawSample = 0.0f;
-
-            switch (oscType)
-            {
-                case 0: rawSample = (float) std::sin (currentAngle); break; // Sine
-                case 1: rawSample = (float) ((currentAngle / juce::MathConstants<double>::pi) - 1.0); break; // Saw
-                case 2: rawSample = currentAngle < juce::MathConstants<double>::pi ? 1.0f : -1.0f; break; // Square
-                case 3: rawSample = (float) (2.0 * std::abs (2.0 * (currentAngle / juce::MathConstants<double>::twoPi) - 1.0) - 1.0); break; // Triangle
-                default: break;
-            }
-
-            auto sampleValue = rawSample * level * envelopeValue;
-            
-            // Apply filter to each sample (simplified for MVP)
-            sampleValue = filter.processSample (0, sampleValue);
-            
-            for (int channel = 0; channel < outputBuffer.getNumChannels(); ++channel)
-                outputBuffer.addSample (channel, startSample + sample, sampleValue);
-
-            currentAngle += angleDelta;
-            if (currentAngle >= juce::MathConstants<double>::twoPi)
-                currentAngle -= juce::MathConstants<double>::twoPi;
+            const float yHP = h * (samples[i] - ls1 * (g + R2) - ls2);
+            const float yBP = yHP * g + ls1;
+            ls1 = yHP * g + yBP;
+            const float yLP = yBP * g + ls2;
+            ls2 = yBP * g + yLP;
+            samples[i] = yLP;
         }
+        s1 = ls1; s2 = ls2;
     }
 
-    void prepare (double sampleRate)
-    {
-        adsr.setSampleRate (sampleRate);
-        juce::ADSR::Parameters adsrParams;
-        adsrParams.attack = 0.05f;
-        adsrParams.decay = 0.1f;
-        adsrParams.sustain = 0.8f;
-        adsrParams.release = 0.5f;
-        adsr.setParameters (adsrParams);
-
-        juce::dsp::ProcessSpec spec { sampleRate, 512, 2 };
-        filter.prepare (spec);
-        filter.setType (juce::dsp::StateVariableTPTFilterType::lowpass);
-    }
-
-    void updateParameters (int type, float cutoff, float resonance)
+private:
+    void update()
     {
-        oscType = type;
-        filter.setCutoffFrequency (juce::jlimit (20.0f, 20000.0f, cutoff));
-        filter.setResonance (juce::jlimit (0.1f, 20.0f, resonance));
+        g = (float) std::tan (juce::MathConstants<double>::pi * cutoff / sampleRate);
+        R2 = 1.0f / resonance;
+        h = 1.0f / (1.0f + R2 * g + g * g);
     }
 
-private:
-    juce::ADSR adsr;
-    juce::dsp::StateVariableTPTFilter<float> filter;
-    double currentAngle = 0.0, angleDelta = 0.0;
-    float level = 0.0f;
-    int oscType = 1; // Default Saw
+    double sampleRate = 44100.0;
+    float cutoff = 1000.0f, resonance = 0.70710678f;
+    float g = 0.0f, R2 = 0.0f, h = 0.0f, s1 = 0.0f, s2 = 0.0f;
 };
 
-// A simple Synthesizer Sound
-struct SynthSound : public juce::SynthesiserSound
+// Wavetable oscillator kernel for the VoiceBank. The tables are band-limited
+// (see Wavetable), so the shape costs one interpolated read per sample whatever the waveform.
+namespace Oscillator
 {
-    SynthSound() {}
-    bool appliesToNote (int) override { return true; }
-    bool appliesToChannel (int) override { return true; }
-};
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int vecSize = (int) Vec::SIMDNumElements;
+
+    // Writes numSamples of a table level to out, stride floats apart, starting at phase (cycles, [0, 1))
+    // and advancing by increment per sample. Returns the phase after the last one.
+    inline float render (const float* level, float* out, int stride, int numSamples, float phase, float increment)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            out[i * stride] = Wavetable::read (level, phase);
+            phase += increment;
+            phase -= phase >= 1.0f ? 1.0f : 0.0f;
+        }
+        return phase;
+    }
+}
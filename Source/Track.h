@@ -1,29 +1,100 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SmoothedParameter.h"
+#include "EpochReclaimer.h"
+#include <memory>
+#include <vector>
 
 enum class TrackType { Audio, Midi };
 
+class VoiceBank;
+class RecordTake;
+
+// A send from a track or bus to a bus. The level can change at any time; the target and
+// tap point only through the Mixer, which recompiles its render plan.
+struct Send
+{
+    Send (int targetBus, bool isPreFader, float initialLevel)
+        : bus (targetBus), preFader (isPreFader), level (initialLevel) {}
+
+    const int bus;
+    const bool preFader;
+    SmoothedParameter<> level;
+
+    JUCE_DECLARE_NON_COPYABLE (Send)
+};
+
 class Track
 {
 public:
     Track (const juce::String& name, TrackType type)
-        : trackName (name), trackType (type) {}
+        : trackName (name), trackType (type)
+    {
+        scheduledMidi.ensureSize (4096); // Preallocated so the sequencer never allocates
+    }
 
     virtual ~Track() = default;
 
-    void setVolume (float v) { volume.store (juce::jlimit (0.0f, 2.0f, v)); }
-    float getVolume() const { return volume.load(); }
+    void setVolume (float v) { volume.set (juce::jlimit (0.0f, 2.0f, v)); touch(); }
+    float getVolume() const { return volume.get(); }
 
-    void setPan (float p) { pan.store (juce::jlimit (-1.0f, 1.0f, p)); }
-    float getPan() const { return pan.load(); }
+    void setPan (float p) { pan.set (juce::jlimit (-1.0f, 1.0f, p)); touch(); }
+    float getPan() const { return pan.get(); }
 
-    void setMuted (bool m) { isMuted.store (m); }
+    void setMuted (bool m) { isMuted.store (m); touch(); }
     bool getIsMuted() const { return isMuted.load(); }
 
-    void setSoloed (bool s) { isSoloed.store (s); }
+    void setSoloed (bool s) { isSoloed.store (s); touch(); }
     bool getIsSoloed() const { return isSoloed.load(); }
 
+    // When the shared voice pool runs out, tracks keep their voices against lower priorities
+    void setVoicePriority (int p) { voicePriority.store (p); touch(); }
+    int getVoicePriority() const { return voicePriority.load(); }
+
+    // Routing, read by the Mixer when it compiles its plan. -1 is the master.
+    int getOutputBus() const { return outputBus; }
+    const std::vector<std::shared_ptr<Send>>& getSends() const { return sends; }
+
+    // Audio Thread: volume and constant-power pan, ramped from where the last block ended
+    void applyFader (juce::AudioBuffer<float>& buffer, int numSamples)
+    {
+        volume.beginBlock();
+        pan.beginBlock();
+
+        const float startVolume = volume.getCurrent(), startPan = pan.getCurrent();
+        const float endVolume = volume.skip (numSamples), endPan = pan.skip (numSamples);
+
+        if (buffer.getNumChannels() >= 2) {
+            buffer.applyGainRamp (0, 0, numSamples, panGain (startVolume, startPan, false), panGain (endVolume, endPan, false));
+            buffer.applyGainRamp (1, 0, numSamples, panGain (startVolume, startPan, true), panGain (endVolume, endPan, true));
+        } else {
+            buffer.applyGainRamp (0, numSamples, startVolume, endVolume);
+        }
+    }
+
+    // Audio Thread: the voices the pool hands out to, nullptr if the track has none
+    virtual VoiceBank* getVoiceBank() { return nullptr; }
+
+    // Audio Thread: where the track's input goes while it records, nullptr otherwise
+    virtual RecordTake* getRecordTake() { return nullptr; }
+
+    // Audio Thread, before processBlock: where the transport is. Only tracks that play prerendered audio need it.
+    virtual void setPlayhead (double /*beat*/, bool /*isPlaying*/) {}
+
+    // Audio Thread: sample-stamped events the sequencer queued for the next block
+    juce::MidiBuffer& getScheduledMidi() { return scheduledMidi; }
+
+    // Per-track render target, so tracks can render on different cores without sharing buffers
+    juce::AudioBuffer<float>& getRenderBuffer() { return renderBuffer; }
+
+    // Audio Thread: set by the Mixer when it skipped the track, so the render buffer holds nothing to sum
+    void setRenderSkipped (bool skipped) { renderSkipped = skipped; }
+    bool wasRenderSkipped() const { return renderSkipped; }
+
+    // Changes whenever a setting shown in the mixer changes, so the UI only resends tracks that did
+    uint32_t getStateVersion() const { return stateVersion.load(); }
+
     const juce::String& getName() const { return trackName; }
     TrackType getType() const { return trackType; }
 
@@ -32,16 +103,59 @@ public:
     virtual void releaseResources() = 0;
     virtual void allNotesOff() = 0;
 
+    // Audio Thread: true if processBlock would produce silence until new events arrive
+    virtual bool isIdle() { return false; }
+
 protected:
+    friend class Mixer; // Edits the routing and keeps the render plan in step
+
+    void touch() { ++stateVersion; }
+
+    // Message Thread: a processor the audio thread may still be using is freed once it cannot be.
+    // Before the track joins a Mixer nothing else can see it, so it goes straight away.
+    void retireProcessor (juce::AudioProcessor* old)
+    {
+        if (old == nullptr) return;
+        if (reclaimer != nullptr) reclaimer->retire (old);
+        else                      delete old;
+    }
+
+    void prepareFader (double sampleRate)
+    {
+        volume.prepare (sampleRate, 0.05);
+        pan.prepare (sampleRate, 0.05);
+        for (auto& send : sends)
+            send->level.prepare (sampleRate, 0.05);
+    }
+
+    // Constant Power Panning (Pro Standard)
+    static float panGain (float v, float p, bool right)
+    {
+        float angle = (p + 1.0f) * (juce::MathConstants<float>::pi / 4.0f);
+        return v * (right ? std::sin (angle) : std::cos (angle));
+    }
+
     juce::String trackName;
     TrackType trackType;
-    std::atomic<float> volume { 0.8f };
-    std::atomic<float> pan { 0.0f };
+    SmoothedParameter<> volume { 0.8f };
+    SmoothedParameter<> pan { 0.0f };
     std::atomic<bool> isMuted { false };
     std::atomic<bool> isSoloed { false };
+    std::atomic<int> voicePriority { 0 };
+    std::atomic<uint32_t> stateVersion { 0 };
+    juce::MidiBuffer scheduledMidi;
+    juce::AudioBuffer<float> renderBuffer;
+    bool renderSkipped = false;
+
+    // Message Thread
+    int outputBus = -1;
+    std::vector<std::shared_ptr<Send>> sends;
+    EpochReclaimer* reclaimer = nullptr; // The owning Mixer's, which pins it around every block
 };
 
 #include "InternalSynth.h"
+#include "Sampler.h"
+#include "TrackFreezer.h"
 
 class InstrumentTrack : public Track
 {
@@ -51,33 +165,97 @@ public:
     void setInstrument (std::unique_ptr<juce::AudioProcessor> newInstrument)
     {
         // This happens on the Message Thread
-        auto* oldInstrument = instrument.exchange (newInstrument.release());
-        if (oldInstrument != nullptr)
-            deletionQueue.add (oldInstrument);
+        auto* synth = dynamic_cast<InternalSynthProcessor*> (newInstrument.get());
+        voiceBank.store (synth != nullptr ? &synth->getVoiceBank() : nullptr);
+        retireProcessor (instrument.exchange (newInstrument.release()));
+        ++instrumentVersion;
+        touch();
     }
 
     ~InstrumentTrack() override
     {
+        if (freezeJob != nullptr)
+            freezeJob->cancel();
         if (auto* inst = instrument.load())
             delete inst;
+        delete frozen.load();
     }
 
     void setParams (int osc, float cut, float res) {
         oscType = osc;
         cutoff = cut;
         resonance = res;
+        ++instrumentVersion;
+        touch();
     }
 
+    // Changes whenever the instrument or its sound does, so a freeze rendered from the old one is out of date
+    uint32_t getInstrumentVersion() const { return instrumentVersion; }
+
+    // Message Thread: a copy of the instrument with the same sound, for rendering on another thread.
+    // nullptr for processors that cannot be copied, which cannot be frozen.
+    std::unique_ptr<juce::AudioProcessor> createOfflineInstrument() const
+    {
+        auto* inst = instrument.load();
+        if (auto* live = dynamic_cast<InternalSynthProcessor*> (inst)) {
+            auto synth = std::make_unique<InternalSynthProcessor>();
+            synth->setWavetable (live->getWavetable());
+            synth->updateParameters (oscType, cutoff, resonance);
+            return synth;
+        }
+        if (auto* sampler = dynamic_cast<SamplerProcessor*> (inst))
+            return sampler->createCopy();
+        return nullptr;
+    }
+
+    // Message Thread: whether the track should play frozen audio; MainComponent keeps it rendered
+    void setFreezeEnabled (bool shouldFreeze)
+    {
+        freezeEnabled = shouldFreeze;
+        if (! shouldFreeze) {
+            setFrozenAudio (nullptr);
+            if (freezeJob != nullptr) freezeJob->cancel();
+            freezeJob.reset();
+        }
+        touch();
+    }
+
+    bool isFreezeEnabled() const { return freezeEnabled; }
+
+    // Message Thread: the audio to play instead of the instrument, nullptr for the instrument
+    void setFrozenAudio (std::unique_ptr<FrozenAudio> audio)
+    {
+        auto* old = frozen.exchange (audio.release());
+        if (old != nullptr) {
+            if (reclaimer != nullptr) reclaimer->retire (old);
+            else                      delete old;
+        }
+        touch();
+    }
+
+    const FrozenAudio* getFrozenAudio() const { return frozen.load(); }
+
+    // Message Thread: the render that will become the frozen audio, if one is running
+    std::shared_ptr<FreezeJob>& getFreezeJob() { return freezeJob; }
+
     int getOscType() const { return oscType; }
     float getCutoff() const { return cutoff; }
     float getResonance() const { return resonance; }
 
     void prepareToPlay (double sampleRate, int samplesPerBlock) override
     {
+        prepareFader (sampleRate);
+
         if (auto* inst = instrument.load())
             inst->prepareToPlay (sampleRate, samplesPerBlock);
     }
 
+    void setPlayhead (double beat, bool isPlaying) override
+    {
+        playheadBeat = beat;
+        playheadRunning = isPlaying;
+    }
+
     void processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages) override
     {
         auto* inst = instrument.load();
@@ -86,32 +264,45 @@ public:
             return;
         }
 
-        inst->processBlock (buffer, midiMessages);
-        
-        float v = volume.load();
-        float p = pan.load();
-        
-        // Constant Power Panning (Pro Standard)
-        float angle = (p + 1.0f) * (juce::MathConstants<float>::pi / 4.0f);
-        float gainL = v * std::cos (angle);
-        float gainR = v * std::sin (angle);
+        auto* frozenAudio = frozen.load();
+        if (frozenAudio != lastFrozen) {
+            // Just frozen: silence the instrument, so it starts clean whenever the track thaws
+            if (lastFrozen == nullptr) {
+                midiMessages.clear();
+                midiMessages.addEvent (juce::MidiMessage::allSoundOff (1), 0);
+                inst->processBlock (buffer, midiMessages);
+            }
+            lastFrozen = frozenAudio;
+            frozenPosition = -1;
+        }
 
-        if (buffer.getNumChannels() >= 2) {
-            buffer.applyGain (0, 0, buffer.getNumSamples(), gainL);
-            buffer.applyGain (1, 0, buffer.getNumSamples(), gainR);
-        } else {
-            buffer.applyGain (v);
+        if (frozenAudio != nullptr) {
+            playFrozen (*frozenAudio, buffer); // Its notes are already in the audio
+            return;
         }
+
+        inst->processBlock (buffer, midiMessages); // Dry: the Mixer applies the fader after any pre-fader sends
     }
 
     void allNotesOff() override {
         if (auto* inst = instrument.load()) {
             if (auto* internalSynth = dynamic_cast<InternalSynthProcessor*> (inst)) {
                 internalSynth->allNotesOff();
+            } else if (auto* sampler = dynamic_cast<SamplerProcessor*> (inst)) {
+                sampler->allNotesOff();
             }
         }
     }
 
+    // Only the internal synth can tell; other processors may have tails of their own
+    bool isIdle() override
+    {
+        if (instrument.load() == nullptr) return true;
+        if (frozen.load() != nullptr) return ! playheadRunning;
+        auto* bank = voiceBank.load();
+        return bank != nullptr && bank->isSilent();
+    }
+
     void releaseResources() override {
         if (auto* inst = instrument.load())
             inst->releaseResources();
@@ -119,11 +310,58 @@ public:
 
     juce::AudioProcessor* getProcessor() const { return instrument.load(); }
 
+    // A frozen track starts no voices, so it claims none from the pool
+    VoiceBank* getVoiceBank() override { return frozen.load() != nullptr ? nullptr : voiceBank.load(); }
+
 private:
+    // Audio Thread: the stretch of the loop under the playhead. Playback that starts or jumps reads
+    // the pass rendered from silence; once it wraps, the pass that carries the previous tail.
+    void playFrozen (const FrozenAudio& f, juce::AudioBuffer<float>& buffer)
+    {
+        buffer.clear();
+        const int numSamples = buffer.getNumSamples();
+        int pos = playheadRunning ? juce::roundToInt ((playheadBeat - f.loopStart) / f.beatsPerSample) : -1; // The beat is a whole sample count, give or take rounding
+        if (pos < 0) {
+            frozenPosition = -1;
+            return;
+        }
+
+        const int drift = std::abs (pos - frozenPosition);
+        if (frozenPosition < 0 || juce::jmin (drift, f.loopSamples - drift) > 1)
+            frozenPass = 0; // Started or jumped
+        else if (pos < frozenPosition - 1)
+            frozenPass = 1; // The transport wrapped between blocks
+
+        for (int done = 0; done < numSamples;) {
+            if (pos >= f.loopSamples) {
+                pos = 0;
+                frozenPass = 1;
+            }
+            const int n = juce::jmin (numSamples - done, f.loopSamples - pos);
+            for (int channel = 0; channel < juce::jmin (buffer.getNumChannels(), f.audio.getNumChannels()); ++channel)
+                buffer.copyFrom (channel, done, f.audio, channel, frozenPass * f.loopSamples + pos, n);
+            done += n;
+            pos += n;
+        }
+        frozenPosition = pos;
+    }
+
     std::atomic<juce::AudioProcessor*> instrument { nullptr };
-    juce::OwnedArray<juce::AudioProcessor> deletionQueue; // Simple way to defer deletion
+    std::atomic<VoiceBank*> voiceBank { nullptr }; // The internal synth's, cached so the audio thread needs no cast
+    std::atomic<FrozenAudio*> frozen { nullptr };
+    std::atomic<uint32_t> instrumentVersion { 0 };
 
     int oscType = 1;
     float cutoff = 2000.0f;
     float resonance = 0.7f;
-};
\ No newline at end of file
+
+    // Message Thread
+    bool freezeEnabled = false;
+    std::shared_ptr<FreezeJob> freezeJob;
+
+    // Audio Thread
+    double playheadBeat = 0.0;
+    bool playheadRunning = false;
+    const FrozenAudio* lastFrozen = nullptr;
+    int frozenPosition = -1, frozenPass = 0;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectModel.h"
+#include "Sequencer.h"
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+// A track's loop rendered through its instrument, which a frozen track plays instead of running it
+struct FrozenAudio
+{
+    // What the audio was rendered from; it is out of date once any of it changes
+    struct Source
+    {
+        uint64_t notesVersion = 0;      // ProjectModel::getTrackVersion
+        uint32_t instrumentVersion = 0; // InstrumentTrack::getInstrumentVersion
+        uint32_t transportVersion = 0;  // Tempo and loop region
+        double sampleRate = 0.0;
+
+        bool operator== (const Source& other) const
+        {
+            return notesVersion == other.notesVersion && instrumentVersion == other.instrumentVersion
+                && transportVersion == other.transportVersion && sampleRate == other.sampleRate;
+        }
+    };
+
+    Source source;
+    double loopStart = 0.0, beatsPerSample = 0.0;
+    int loopSamples = 0;
+    juce::AudioBuffer<float> audio; // The loop twice: once from silence, then again over the first pass's tail
+};
+
+// One freeze being rendered: a private copy of the track's instrument and the notes as they were
+// when it started. Only the TrackFreezer's thread touches either.
+class FreezeJob
+{
+public:
+    FreezeJob (std::unique_ptr<juce::AudioProcessor> offlineInstrument, TrackNotes trackNotes, const Transport& transport,
+               const FrozenAudio::Source& from, int renderBlockSize)
+        : instrument (std::move (offlineInstrument)), notes (std::move (trackNotes)), source (from),
+          bpm (transport.getBpm()), loopStart (transport.getLoopStart()), loopEnd (transport.getLoopEnd()),
+          blockSize (juce::jlimit (16, 8192, renderBlockSize))
+    {
+    }
+
+    // Any thread: the freezer drops the job at its next block
+    void cancel() { cancelled.store (true); }
+
+    // Message Thread
+    bool isFinished() const { return finished.load (std::memory_order_acquire); }
+    const FrozenAudio::Source& getSource() const { return source; }
+    double getRenderSeconds() const { return renderSeconds; }
+
+    // Message Thread, once finished: nullptr if it was cancelled
+    std::unique_ptr<FrozenAudio> takeResult() { return isFinished() ? std::move (result) : nullptr; }
+
+private:
+    friend class TrackFreezer;
+
+    std::unique_ptr<juce::AudioProcessor> instrument;
+    const TrackNotes notes;
+    const FrozenAudio::Source source;
+    const double bpm, loopStart, loopEnd;
+    const int blockSize;
+
+    std::unique_ptr<FrozenAudio> result;
+    double renderSeconds = 0.0;
+    std::atomic<bool> cancelled { false }, finished { false };
+
+    JUCE_DECLARE_NON_COPYABLE (FreezeJob)
+};
+
+// Renders freezes on one background thread, oldest request first, as fast as the instrument
+// runs. The result is the track's dry loop; the fader, sends and mutes still apply live.
+class TrackFreezer : private juce::Thread
+{
+public:
+    TrackFreezer() : juce::Thread ("TrackFreezer") { startThread(); }
+    ~TrackFreezer() override { stopThread (5000); }
+
+    // Message Thread: renders notes through instrument, a copy the audio thread never sees, over the
+    // transport's loop region at source.sampleRate. Rendering in the device's block size keeps the
+    // instrument's per-block steps where they fall live.
+    std::shared_ptr<FreezeJob> start (std::unique_ptr<juce::AudioProcessor> instrument, TrackNotes notes, const Transport& transport,
+                                      const FrozenAudio::Source& source, int blockSize)
+    {
+        auto job = std::make_shared<FreezeJob> (std::move (instrument), std::move (notes), transport, source, blockSize);
+        {
+            std::lock_guard<std::mutex> lock (jobsMutex);
+            jobs.push_back (job);
+        }
+        notify();
+        return job;
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            std::shared_ptr<FreezeJob> job;
+            {
+                std::lock_guard<std::mutex> lock (jobsMutex);
+                if (! jobs.empty())
+                {
+                    job = std::move (jobs.front());
+                    jobs.pop_front();
+                }
+            }
+
+            if (job == nullptr)
+            {
+                wait (-1);
+                continue;
+            }
+
+            render (*job);
+            job->instrument.reset(); // A sampler copy stops holding streams as soon as it is done
+            job->finished.store (true, std::memory_order_release);
+        }
+    }
+
+    // The loop twice from a stopped transport, the same way the audio thread would sequence it
+    void render (FreezeJob& job)
+    {
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+        const double sampleRate = job.source.sampleRate;
+        const int blockSize = job.blockSize;
+        auto& instrument = *job.instrument;
+
+        Transport clock;
+        clock.setBpm (job.bpm);
+        clock.setLoopRegion (job.loopStart, job.loopEnd);
+        clock.reset();
+        clock.setPlaying (true);
+
+        auto frozen = std::make_unique<FrozenAudio>();
+        frozen->source = job.source;
+        frozen->loopStart = clock.getLoopStart();
+        frozen->beatsPerSample = clock.getBeatsPerSample (sampleRate);
+        frozen->loopSamples = (int) std::ceil (clock.getLoopLength() / frozen->beatsPerSample);
+        frozen->audio.setSize (2, 2 * frozen->loopSamples);
+
+        instrument.setNonRealtime (true);
+        instrument.prepareToPlay (sampleRate, blockSize);
+
+        juce::AudioBuffer<float> block (2, blockSize);
+        juce::MidiBuffer midi;
+        midi.ensureSize (4096);
+
+        const int totalSamples = frozen->audio.getNumSamples();
+        for (int pos = 0; pos < totalSamples;)
+        {
+            if (job.cancelled.load() || threadShouldExit()) return;
+
+            const int numSamples = juce::jmin (blockSize, totalSamples - pos);
+            juce::AudioBuffer<float> view (block.getArrayOfWritePointers(), block.getNumChannels(), numSamples);
+            view.clear();
+
+            const double beatBefore = clock.getCurrentBeat();
+            clock.advance (numSamples, sampleRate);
+            Sequencer::scheduleTrack (job.notes, { beatBefore, clock.getCurrentBeat(), clock, numSamples, sampleRate }, midi);
+
+            instrument.processBlock (view, midi);
+            midi.clear();
+
+            for (int channel = 0; channel < frozen->audio.getNumChannels(); ++channel)
+                frozen->audio.copyFrom (channel, pos, view, channel, 0, numSamples);
+            pos += numSamples;
+        }
+
+        instrument.releaseResources();
+        job.renderSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+        job.result = std::move (frozen);
+    }
+
+    std::mutex jobsMutex;
+    std::deque<std::shared_ptr<FreezeJob>> jobs;
+
+    JUCE_DECLARE_NON_COPYABLE (TrackFreezer)
+};
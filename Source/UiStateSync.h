@@ -0,0 +1,248 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "ProjectModel.h"
+#include "Mixer.h"
+#include "AudioTrack.h"
+#include <iterator>
+
+// Builds the per-tick update for the WebView from version counters instead of resending everything.
+// Every update carries the playhead and a sequence number. Notes of the selected track, track
+// strips and transport settings are only included when their version moved since they were last
+// sent, notes as added/removed lists. The page asks for a full resync when it (re)loads or sees a
+// gap in the sequence; that is the only time the whole state is sent.
+class UiStateSync
+{
+public:
+    // Message Thread
+    void requestFullSync() { fullSyncRequested = true; }
+
+    // Message Thread: returns a void var when nothing changed, unless force is set (e.g. to carry logs)
+    juce::var buildUpdate (const ProjectModel& model, const Transport& transport, const Mixer& mixer, int selectedTrack, bool force = false)
+    {
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        const bool full = fullSyncRequested;
+        fullSyncRequested = false;
+        bool changed = full || force;
+
+        const double beat = transport.getCurrentBeat();
+        const bool playing = transport.getIsPlaying();
+        if (beat != sentBeat || playing != sentPlaying)
+        {
+            sentBeat = beat;
+            sentPlaying = playing;
+            changed = true;
+        }
+
+        const auto transportVersion = transport.getStateVersion();
+        if (full || transportVersion != sentTransportVersion)
+        {
+            sentTransportVersion = transportVersion;
+            obj->setProperty ("loopStart", transport.getLoopStart());
+            obj->setProperty ("loopEnd", transport.getLoopEnd());
+            obj->setProperty ("bpm", transport.getBpm());
+            changed = true;
+        }
+
+        changed = addNoteChanges (*obj, model, selectedTrack, full) || changed;
+        changed = addTrackChanges (*obj, mixer, full) || changed;
+        changed = addBusChanges (*obj, mixer, full) || changed;
+
+        if (! changed) return {};
+
+        if (full) obj->setProperty ("full", true);
+        obj->setProperty ("seq", ++sequence);
+        obj->setProperty ("beat", beat);
+        obj->setProperty ("playing", playing);
+        obj->setProperty ("selectedTrack", selectedTrack);
+        return juce::var (obj.get());
+    }
+
+private:
+    // Full comparison, so a note that moved or changed length shows up as removed + added
+    static bool noteLess (const NoteEvent& a, const NoteEvent& b)
+    {
+        if (a.startBeat != b.startBeat) return a.startBeat < b.startBeat;
+        if (a.note != b.note) return a.note < b.note;
+        if (a.durationBeats != b.durationBeats) return a.durationBeats < b.durationBeats;
+        return a.velocity < b.velocity;
+    }
+
+    static juce::var noteToVar (const NoteEvent& n)
+    {
+        juce::DynamicObject::Ptr nObj = new juce::DynamicObject();
+        nObj->setProperty ("n", n.note);
+        nObj->setProperty ("s", n.startBeat);
+        nObj->setProperty ("d", n.durationBeats);
+        return juce::var (nObj.get());
+    }
+
+    bool addNoteChanges (juce::DynamicObject& obj, const ProjectModel& model, int selectedTrack, bool full)
+    {
+        const bool trackSwitched = selectedTrack != sentNotesTrack;
+        if (! full && ! trackSwitched && model.getTrackVersion (selectedTrack) == sentNotesVersion)
+            return false;
+
+        uint64_t version = 0;
+        auto notes = model.getNotes (selectedTrack, version);
+        std::sort (notes.begin(), notes.end(), noteLess);
+
+        if (full || trackSwitched)
+        {
+            juce::Array<juce::var> notesArray;
+            for (const auto& n : notes)
+                notesArray.add (noteToVar (n));
+            obj.setProperty ("notes", notesArray);
+        }
+        else
+        {
+            std::vector<NoteEvent> added, removed;
+            std::set_difference (notes.begin(), notes.end(), sentNotes.begin(), sentNotes.end(), std::back_inserter (added), noteLess);
+            std::set_difference (sentNotes.begin(), sentNotes.end(), notes.begin(), notes.end(), std::back_inserter (removed), noteLess);
+
+            juce::Array<juce::var> addedArray, removedArray;
+            for (const auto& n : added) addedArray.add (noteToVar (n));
+            for (const auto& n : removed) removedArray.add (noteToVar (n));
+            obj.setProperty ("notesAdded", addedArray);
+            obj.setProperty ("notesRemoved", removedArray);
+        }
+
+        sentNotes = std::move (notes);
+        sentNotesTrack = selectedTrack;
+        sentNotesVersion = version;
+        return true;
+    }
+
+    bool addTrackChanges (juce::DynamicObject& obj, const Mixer& mixer, bool full)
+    {
+        // A removal shifts every later track, so the whole list goes again
+        if (mixer.getLayoutVersion() != sentLayoutVersion)
+        {
+            sentLayoutVersion = mixer.getLayoutVersion();
+            full = true;
+        }
+
+        const int nTracks = mixer.getNumTracks();
+        juce::Array<juce::var> tracksArray;
+
+        for (int i = 0; i < nTracks; ++i)
+        {
+            auto* t = mixer.getTrack (i);
+            if (t == nullptr) continue;
+
+            const auto version = t->getStateVersion(); // Read before the values, so a racing edit is resent next tick
+            const bool isNew = i >= (int) sentTrackVersions.size();
+            if (! full && ! isNew && version == sentTrackVersions[(size_t) i])
+                continue;
+
+            juce::DynamicObject::Ptr tObj = new juce::DynamicObject();
+            tObj->setProperty ("i", i);
+            tObj->setProperty ("name", t->getName());
+            tObj->setProperty ("vol", t->getVolume());
+            tObj->setProperty ("pan", t->getPan());
+            tObj->setProperty ("mute", t->getIsMuted());
+            tObj->setProperty ("solo", t->getIsSoloed());
+            tObj->setProperty ("prio", t->getVoicePriority());
+            addRouting (*tObj, *t);
+
+            if (auto* inst = dynamic_cast<InstrumentTrack*> (t)) {
+                tObj->setProperty ("osc", inst->getOscType());
+                tObj->setProperty ("cutoff", inst->getCutoff());
+                tObj->setProperty ("res", inst->getResonance());
+                if (auto* processor = inst->getProcessor())
+                    tObj->setProperty ("inst", processor->getName());
+                if (inst->isFreezeEnabled())
+                    tObj->setProperty ("frz", inst->getFrozenAudio() != nullptr ? 2 : 1); // Frozen, or rendering
+            }
+            else if (auto* audio = dynamic_cast<AudioTrack*> (t)) {
+                tObj->setProperty ("audio", true);
+                tObj->setProperty ("arm", audio->getIsArmed());
+                tObj->setProperty ("rec", audio->isRecording());
+                tObj->setProperty ("in", audio->getFirstInput());
+            }
+
+            tracksArray.add (juce::var (tObj.get()));
+            if (isNew) sentTrackVersions.resize ((size_t) i + 1);
+            sentTrackVersions[(size_t) i] = version;
+        }
+
+        const bool countChanged = nTracks != (int) sentTrackVersions.size();
+        if (countChanged)
+            sentTrackVersions.resize ((size_t) nTracks);
+
+        if (tracksArray.isEmpty() && ! countChanged && ! full)
+            return false;
+
+        obj.setProperty ("numTracks", nTracks);
+        obj.setProperty ("tracks", tracksArray);
+        return true;
+    }
+
+    // Output bus (-1 master) and sends, shared by track and bus strips
+    static void addRouting (juce::DynamicObject& strip, const Track& t)
+    {
+        juce::Array<juce::var> sendsArray;
+        for (const auto& send : t.getSends())
+        {
+            juce::DynamicObject::Ptr sObj = new juce::DynamicObject();
+            sObj->setProperty ("bus", send->bus);
+            sObj->setProperty ("level", send->level.get());
+            sObj->setProperty ("pre", send->preFader);
+            sendsArray.add (juce::var (sObj.get()));
+        }
+
+        strip.setProperty ("out", t.getOutputBus());
+        strip.setProperty ("sends", sendsArray);
+    }
+
+    // Same scheme as the tracks; buses are never removed, so only new and changed ones are sent
+    bool addBusChanges (juce::DynamicObject& obj, const Mixer& mixer, bool full)
+    {
+        const int nBuses = mixer.getNumBuses();
+        juce::Array<juce::var> busesArray;
+
+        for (int i = 0; i < nBuses; ++i)
+        {
+            auto* b = mixer.getBus (i);
+            const auto version = b->getStateVersion();
+            const bool isNew = i >= (int) sentBusVersions.size();
+            if (! full && ! isNew && version == sentBusVersions[(size_t) i])
+                continue;
+
+            juce::DynamicObject::Ptr bObj = new juce::DynamicObject();
+            bObj->setProperty ("i", i);
+            bObj->setProperty ("name", b->getName());
+            bObj->setProperty ("kind", b->getKind() == Bus::Kind::group ? "group" : "fx");
+            bObj->setProperty ("vol", b->getVolume());
+            bObj->setProperty ("pan", b->getPan());
+            bObj->setProperty ("mute", b->getIsMuted());
+            addRouting (*bObj, *b);
+
+            busesArray.add (juce::var (bObj.get()));
+            if (isNew) sentBusVersions.resize ((size_t) i + 1);
+            sentBusVersions[(size_t) i] = version;
+        }
+
+        if (busesArray.isEmpty() && ! full)
+            return false;
+
+        obj.setProperty ("numBuses", nBuses);
+        obj.setProperty ("buses", busesArray);
+        return true;
+    }
+
+    bool fullSyncRequested = true;
+    juce::int64 sequence = 0;
+
+    double sentBeat = -1.0;
+    bool sentPlaying = false;
+    uint32_t sentTransportVersion = 0;
+
+    int sentNotesTrack = -1;
+    uint64_t sentNotesVersion = 0;
+    std::vector<NoteEvent> sentNotes;
+
+    std::vector<uint32_t> sentTrackVersions;
+    uint32_t sentLayoutVersion = 0;
+    std::vector<uint32_t> sentBusVersions;
+};
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SynthEngine.h"
+#include <atomic>
+
+// Voices that any bank of a VoicePool may start beyond its own grant for the block
+struct SharedVoiceBudget
+{
+    std::atomic<int> spare { 0 };
+    std::atomic<uint64_t> dropped { 0 }; // Note-ons that found no voice
+
+    bool tryTake()
+    {
+        auto n = spare.load (std::memory_order_relaxed);
+        while (n > 0)
+            if (spare.compare_exchange_weak (n, n - 1, std::memory_order_relaxed))
+                return true;
+        return false;
+    }
+};
+
+// Polyphonic engine for one patch, stored structure-of-arrays so that one SIMD register
+// holds the same field of several voices. Each voice reads its own mip level of the patch's
+// wavetable, one interpolated read per sample; envelope and level then run for a whole
+// register of voices per instruction. Free lanes have zero level, so they are
+// silent without any branching. A register with no sounding voice is skipped, so the
+// cost grows with the voices actually playing, one register width at a time.
+// Every voice uses the patch's filter coefficients and the filter is linear, so filtering
+// the sum of the voices is the same as filtering each one: a bank needs only one filter.
+class VoiceBank
+{
+public:
+    static constexpr int maxVoices = 64;
+
+    VoiceBank()
+    {
+        for (int lane = 0; lane < maxVoices; ++lane)
+            silenceLane (lane);
+        updateTable(); // Builds the shared tables the first time, off the audio thread
+    }
+
+    void prepare (double newSampleRate)
+    {
+        sampleRate = newSampleRate;
+        filter.setSampleRate (sampleRate);
+        filter.reset();
+        allNotesOff (false);
+    }
+
+    // Audio Thread: the patch owner feeds these from its smoothed parameters
+    void setWaveform (Waveform newWaveform)
+    {
+        waveform = newWaveform;
+        updateTable();
+    }
+
+    // The table Waveform::wavetable plays; it must outlive the bank or be replaced first
+    void setUserWavetable (const Wavetable* newTable)
+    {
+        userTable = newTable;
+        updateTable();
+    }
+
+    void setFilter (float cutoff, float resonance) { filter.setParameters (cutoff, resonance); }
+
+    void setEnvelope (const juce::ADSR::Parameters& newParams) { envelopeParams = newParams; }
+
+    // Audio Thread, before the block renders: how many voices this bank may start (see VoicePool).
+    // Without a budget the bank is only limited by its own lanes.
+    void setVoiceGrant (SharedVoiceBudget* budget, int numVoices, uint64_t blockIndex)
+    {
+        sharedBudget = budget;
+        grantedVoices = numVoices;
+        currentBlock = blockIndex;
+    }
+
+    void noteOn (int noteNumber, float velocity)
+    {
+        if (! takeVoice())
+        {
+            sharedBudget->dropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Same as juce::Synthesiser: a note that is already sounding is released before it retriggers
+        for (int lane = 0; lane < maxVoices; ++lane)
+            if (notes[lane] == noteNumber && ! releasing[lane])
+                releaseLane (lane);
+
+        const int lane = findLaneForNewNote();
+        notes[lane] = noteNumber;
+        releasing[lane] = false;
+        startOrder[lane] = ++noteCounter;
+        startBlocks[lane] = currentBlock;
+
+        phases[lane] = 0.0f;
+        increments[lane] = (float) (juce::MidiMessage::getMidiNoteInHertz (noteNumber) / sampleRate);
+        mipLevels[lane] = Wavetable::getLevelFor (increments[lane]);
+        levels[lane] = velocity * 0.25f;
+
+        // Attack from wherever the lane's envelope is (a stolen voice does not click to zero), then decay, then hold
+        slopes[lane] = rampRate (1.0f, envelopeParams.attack);
+        targets[lane] = 1.0f;
+        nextSlopes[lane] = -rampRate (1.0f - envelopeParams.sustain, envelopeParams.decay);
+        nextTargets[lane] = envelopeParams.sustain;
+    }
+
+    void noteOff (int noteNumber, bool allowTailOff)
+    {
+        for (int lane = 0; lane < maxVoices; ++lane)
+            if (notes[lane] == noteNumber && ! releasing[lane])
+                allowTailOff ? releaseLane (lane) : silenceLane (lane);
+    }
+
+    void allNotesOff (bool allowTailOff)
+    {
+        for (int lane = 0; lane < maxVoices; ++lane)
+            if (notes[lane] >= 0)
+                allowTailOff ? releaseLane (lane) : silenceLane (lane);
+    }
+
+    // Voices that count against a budget: stolen ones fading out do not
+    int getNumActiveVoices() const
+    {
+        int count = 0;
+        for (int lane = 0; lane < maxVoices; ++lane)
+            count += isLaneStealable (lane) ? 1 : 0;
+        return count;
+    }
+
+    // Audio Thread: no voice sounding and the filter has rung out, so render() would add nothing
+    bool isSilent() const
+    {
+        for (int lane0 = 0; lane0 < maxVoices; lane0 += vecSize)
+            if (isRegisterSounding (lane0)) return false;
+        return filter.isSettled (silenceThreshold);
+    }
+
+    // Lane state for VoicePool's stealing, read between blocks
+    bool isLaneStealable (int lane) const       { return notes[lane] >= 0 && ! stolen[lane]; }
+    bool isLaneReleasing (int lane) const       { return releasing[lane]; }
+    float getLaneLevel (int lane) const         { return envelopes[lane] * levels[lane]; }
+    uint64_t getLaneStartBlock (int lane) const { return startBlocks[lane]; }
+    uint32_t getLaneStartOrder (int lane) const { return startOrder[lane]; }
+
+    // Audio Thread, between blocks: fades the voice out quickly so another note can have it
+    void stealLane (int lane)
+    {
+        releaseLane (lane, stealFadeSeconds);
+        stolen[lane] = true;
+    }
+
+    // Audio Thread: adds numSamples from startSample to every channel of the buffer
+    void render (juce::AudioBuffer<float>& buffer, int startSample, int numSamples)
+    {
+        while (numSamples > 0)
+        {
+            const int n = juce::jmin (numSamples, chunkSize);
+            if (renderVoices (n))
+            {
+                for (int i = 0; i < n; ++i)
+                    mono[i] = Vec::fromRawArray (laneSums + i * vecSize).sum();
+            }
+            else
+            {
+                // Nothing sounding: let the filter ring out, then there is nothing left to add
+                if (filter.isSettled (silenceThreshold))
+                {
+                    filter.reset();
+                    return;
+                }
+                juce::FloatVectorOperations::clear (mono, n);
+            }
+
+            filter.process (mono, n);
+
+            for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+                juce::FloatVectorOperations::add (buffer.getWritePointer (channel, startSample), mono, n);
+
+            startSample += n;
+            numSamples -= n;
+        }
+    }
+
+private:
+    using Vec = Oscillator::Vec;
+    static constexpr int vecSize = Oscillator::vecSize;
+    static constexpr int chunkSize = 128;
+    static constexpr float silenceThreshold = 1.0e-5f; // -100 dB
+    static constexpr float stealFadeSeconds = 0.005f; // Short enough to free the voice quickly, long enough not to click
+    static_assert (maxVoices % vecSize == 0, "Voices must fill whole registers");
+
+    // Renders every register with a sounding voice into laneSums and frees voices whose release ended.
+    // Returns false if no voice was sounding.
+    bool renderVoices (int numSamples)
+    {
+        juce::FloatVectorOperations::clear (laneSums, numSamples * vecSize);
+        bool anySounding = false;
+
+        for (int lane0 = 0; lane0 < maxVoices; lane0 += vecSize)
+        {
+            if (! isRegisterSounding (lane0)) continue;
+            anySounding = true;
+
+            renderRegister (lane0, numSamples);
+
+            for (int lane = lane0; lane < lane0 + vecSize; ++lane)
+                if (releasing[lane] && envelopes[lane] <= 0.0f)
+                    silenceLane (lane);
+        }
+        return anySounding;
+    }
+
+    void renderRegister (int lane0, int numSamples)
+    {
+        // Oscillators first, a lane at a time since each voice reads its own level, interleaved so the
+        // pass below loads one register per sample. Free lanes keep whatever is there; their level is zero.
+        for (int lane = lane0; lane < lane0 + vecSize; ++lane)
+            if (notes[lane] >= 0)
+                phases[lane] = Oscillator::render (table->getLevel (mipLevels[lane]), oscillators + (lane - lane0), vecSize,
+                                                   numSamples, phases[lane], increments[lane]);
+
+        const auto zero = Vec::expand (0.0f);
+        const auto level = Vec::fromRawArray (levels + lane0);
+        auto envelope = Vec::fromRawArray (envelopes + lane0);
+        auto slope = Vec::fromRawArray (slopes + lane0);
+        auto target = Vec::fromRawArray (targets + lane0);
+        auto nextSlope = Vec::fromRawArray (nextSlopes + lane0);
+        const auto nextTarget = Vec::fromRawArray (nextTargets + lane0);
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            // Envelope: step towards the stage target, then on arrival switch to the next stage
+            // (attack -> decay -> sustain, release -> zero). The sustain stage has zero slope and stays put.
+            envelope = envelope + slope;
+            envelope = select (Vec::greaterThan (slope, zero), Vec::min (envelope, target), Vec::max (envelope, target));
+            const auto arrived = Vec::equal (envelope, target);
+            slope = select (arrived, nextSlope, slope);
+            target = select (arrived, nextTarget, target);
+            nextSlope = nextSlope & ~arrived;
+
+            auto* sums = laneSums + i * vecSize;
+            (Vec::fromRawArray (sums) + Vec::fromRawArray (oscillators + i * vecSize) * envelope * level).copyToRawArray (sums);
+        }
+
+        envelope.copyToRawArray (envelopes + lane0);
+        slope.copyToRawArray (slopes + lane0);
+        target.copyToRawArray (targets + lane0);
+        nextSlope.copyToRawArray (nextSlopes + lane0);
+    }
+
+    static Vec select (Vec::vMaskType mask, Vec ifSet, Vec ifClear)
+    {
+        return (ifSet & mask) + (ifClear & ~mask); // One side is always +0, so the sum is exact
+    }
+
+    void updateTable()
+    {
+        table = waveform == Waveform::wavetable && userTable != nullptr ? userTable : &Wavetable::getBuiltin (waveform);
+    }
+
+    bool isRegisterSounding (int lane0) const
+    {
+        for (int lane = lane0; lane < lane0 + vecSize; ++lane)
+            if (notes[lane] >= 0) return true;
+        return false;
+    }
+
+    // Per-sample step covering distance in the given time; at least one sample, so no stage stalls
+    float rampRate (float distance, float seconds) const
+    {
+        return distance / (float) juce::jmax (1.0, seconds * sampleRate);
+    }
+
+    bool takeVoice()
+    {
+        if (sharedBudget == nullptr) return true;
+        if (grantedVoices > 0) { --grantedVoices; return true; }
+        return sharedBudget->tryTake();
+    }
+
+    void releaseLane (int lane) { releaseLane (lane, envelopeParams.release); }
+
+    void releaseLane (int lane, float seconds)
+    {
+        releasing[lane] = true;
+        slopes[lane] = -rampRate (envelopes[lane], seconds);
+        targets[lane] = 0.0f;
+        nextSlopes[lane] = 0.0f;
+        nextTargets[lane] = 0.0f;
+    }
+
+    void silenceLane (int lane)
+    {
+        notes[lane] = -1;
+        releasing[lane] = stolen[lane] = false;
+        levels[lane] = envelopes[lane] = slopes[lane] = targets[lane] = 0.0f;
+        nextSlopes[lane] = nextTargets[lane] = 0.0f;
+    }
+
+    // A free lane, else the quietest released voice, else the oldest held one
+    int findLaneForNewNote() const
+    {
+        int quietestReleased = -1, oldest = 0;
+        for (int lane = 0; lane < maxVoices; ++lane)
+        {
+            if (notes[lane] < 0) return lane;
+
+            if (releasing[lane] && (quietestReleased < 0 || envelopes[lane] < envelopes[quietestReleased]))
+                quietestReleased = lane;
+            if (startOrder[lane] < startOrder[oldest])
+                oldest = lane;
+        }
+        return quietestReleased >= 0 ? quietestReleased : oldest;
+    }
+
+    double sampleRate = 44100.0;
+    Waveform waveform = Waveform::saw;
+    const Wavetable* userTable = nullptr;
+    const Wavetable* table = nullptr; // The one the voices read
+    juce::ADSR::Parameters envelopeParams { 0.05f, 0.1f, 0.8f, 0.5f };
+    SvfLowpass filter;
+
+    // Voice state, one lane per voice
+    alignas (64) float phases[maxVoices];
+    alignas (64) float increments[maxVoices];
+    alignas (64) float levels[maxVoices];
+    alignas (64) float envelopes[maxVoices];
+    alignas (64) float slopes[maxVoices];
+    alignas (64) float targets[maxVoices];
+    alignas (64) float nextSlopes[maxVoices];
+    alignas (64) float nextTargets[maxVoices];
+    int mipLevels[maxVoices] = {};
+
+    // Bookkeeping, only touched on note events and between chunks
+    int notes[maxVoices];
+    bool releasing[maxVoices];
+    bool stolen[maxVoices];
+    uint32_t startOrder[maxVoices] = {};
+    uint64_t startBlocks[maxVoices] = {};
+    uint32_t noteCounter = 0;
+
+    // Set per block by the VoicePool, if any
+    SharedVoiceBudget* sharedBudget = nullptr;
+    int grantedVoices = 0;
+    uint64_t currentBlock = 0;
+
+    alignas (64) float oscillators[chunkSize * vecSize] = {}; // Zeroed, so a free lane never holds a NaN
+    alignas (64) float laneSums[chunkSize * vecSize];
+    alignas (64) float mono[chunkSize];
+
+    JUCE_DECLARE_NON_COPYABLE (VoiceBank)
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "VoiceBank.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// One voice budget shared by every track's VoiceBank, sized from what the CPU can render.
+// Lanes stay in each bank (a bank's lanes share its patch and filter), so what the pool hands
+// out is the right to sound a voice. Before the tracks render, the audio thread walks them in
+// order: each gets as many voices as it has note-ons this block while the budget lasts, and
+// when it runs out the pool steals the least valuable voice of any track of equal or lower
+// priority. Voices left over go to a shared spare count for notes that were not scheduled
+// (live input). A note-on that finds neither is dropped and counted.
+// All of this happens on one thread between blocks, so stealing never touches a bank that
+// is rendering, and the outcome does not depend on how the tracks were spread over cores.
+class VoicePool
+{
+public:
+    static constexpr int autoBudget = -1;
+    static constexpr int minBudget = 8;
+    static constexpr int maxBudget = 1024;
+
+    // What the pool needs to know about one track for the block
+    struct Client
+    {
+        VoiceBank* bank = nullptr;             // nullptr if the track has no pooled voices
+        const juce::MidiBuffer* midi = nullptr; // The block's note-ons, nullptr if the track will not render
+        int priority = 0;                       // Higher keeps its voices against lower
+    };
+
+    struct Counters
+    {
+        int budget = 0, active = 0;
+        uint64_t stolen = 0, dropped = 0;
+    };
+
+    // Message Thread: a fixed number of voices, or autoBudget to measure at prepare()
+    void setBudget (int numVoices) { requestedBudget = numVoices; }
+
+    // Message Thread, with the device stopped
+    void prepare (double sampleRate, int blockSize, int numRenderThreads)
+    {
+        const int newBudget = requestedBudget >= 0 ? juce::jlimit (1, maxBudget, requestedBudget)
+                                                   : measureBudget (sampleRate, blockSize, numRenderThreads);
+        budget.store (newBudget);
+
+        // Candidates are voices counted against the budget, plus a bank of slack for live notes
+        candidates.clear();
+        candidates.reserve ((size_t) (newBudget + VoiceBank::maxVoices));
+    }
+
+    // Audio Thread, before the tracks render. clientAt (i) returns the Client for track i.
+    template <typename ClientAt>
+    void allocate (int numClients, ClientAt&& clientAt)
+    {
+        ++blockIndex;
+
+        int active = 0;
+        for (int i = 0; i < numClients; ++i)
+            if (auto* bank = clientAt (i).bank)
+                active += bank->getNumActiveVoices();
+
+        int free = juce::jmax (0, budget.load (std::memory_order_relaxed) - active);
+        candidatesGathered = false;
+
+        for (int i = 0; i < numClients; ++i)
+        {
+            const auto client = clientAt (i);
+            if (client.bank == nullptr) continue;
+
+            const int demand = client.midi != nullptr ? countNoteOns (*client.midi) : 0;
+            int grant = juce::jmin (demand, free);
+            free -= grant;
+
+            for (int shortfall = demand - grant; shortfall > 0; --shortfall)
+            {
+                if (! stealVoice (client.priority, numClients, clientAt)) break;
+                ++grant;
+            }
+
+            client.bank->setVoiceGrant (&shared, grant, blockIndex);
+        }
+
+        shared.spare.store (free, std::memory_order_relaxed);
+        activeVoices.store (active, std::memory_order_relaxed);
+    }
+
+    // Any thread
+    Counters getCounters() const
+    {
+        return { budget.load(), activeVoices.load(), stolenVoices.load(), shared.dropped.load() };
+    }
+
+private:
+    struct Candidate
+    {
+        VoiceBank* bank;
+        int lane, priority;
+        bool releasing;
+        float level;
+        uint64_t startBlock;
+        uint32_t startOrder;
+
+        // Steal order: lower priority tracks first, then released voices from the quietest,
+        // then held voices from the oldest
+        bool operator< (const Candidate& other) const
+        {
+            if (priority != other.priority)   return priority < other.priority;
+            if (releasing != other.releasing) return releasing;
+            if (releasing)                    return level < other.level;
+            if (startBlock != other.startBlock) return startBlock < other.startBlock;
+            if (bank == other.bank)           return startOrder < other.startOrder;
+            return level < other.level;
+        }
+    };
+
+    static int countNoteOns (const juce::MidiBuffer& midi)
+    {
+        int count = 0;
+        for (const auto metadata : midi)
+            count += metadata.getMessage().isNoteOn() ? 1 : 0;
+        return count;
+    }
+
+    // Gathered and sorted at the first shortfall of a block; later steals continue down the list
+    template <typename ClientAt>
+    bool stealVoice (int requesterPriority, int numClients, ClientAt& clientAt)
+    {
+        if (! candidatesGathered)
+        {
+            candidates.clear();
+            for (int i = 0; i < numClients; ++i)
+            {
+                const auto client = clientAt (i);
+                if (client.bank == nullptr) continue;
+
+                for (int lane = 0; lane < VoiceBank::maxVoices && candidates.size() < candidates.capacity(); ++lane)
+                    if (client.bank->isLaneStealable (lane))
+                        candidates.push_back ({ client.bank, lane, client.priority, client.bank->isLaneReleasing (lane),
+                                                client.bank->getLaneLevel (lane), client.bank->getLaneStartBlock (lane),
+                                                client.bank->getLaneStartOrder (lane) });
+            }
+
+            std::sort (candidates.begin(), candidates.end());
+            nextCandidate = 0;
+            candidatesGathered = true;
+        }
+
+        // Sorted by priority first, so the next candidate is either allowed or none is
+        if (nextCandidate >= candidates.size() || candidates[nextCandidate].priority > requesterPriority)
+            return false;
+
+        const auto& victim = candidates[nextCandidate++];
+        victim.bank->stealLane (victim.lane);
+        stolenVoices.fetch_add (1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Renders a scratch bank to see how many voices fit in cpuShare of every render thread's block period
+    static int measureBudget (double sampleRate, int blockSize, int numRenderThreads)
+    {
+        constexpr int probeVoices = 32, probeBlocks = 16;
+        constexpr double cpuShare = 0.5; // The rest is for mixing, effects and headroom
+
+        if (sampleRate <= 0.0 || blockSize <= 0) return minBudget;
+
+        auto bank = std::make_unique<VoiceBank>();
+        bank->prepare (sampleRate);
+        for (int i = 0; i < probeVoices; ++i)
+            bank->noteOn (36 + i, 0.8f);
+
+        juce::AudioBuffer<float> buffer (2, blockSize);
+        bank->render (buffer, 0, blockSize); // Warm up
+
+        const auto start = juce::Time::getHighResolutionTicks();
+        for (int b = 0; b < probeBlocks; ++b)
+            bank->render (buffer, 0, blockSize);
+        const double secondsPerVoiceBlock = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - start)
+                                              / (probeBlocks * probeVoices);
+
+        const double available = cpuShare * blockSize / sampleRate * (juce::jmax (0, numRenderThreads) + 1);
+        if (secondsPerVoiceBlock <= 0.0) return maxBudget;
+        return (int) juce::jlimit ((double) minBudget, (double) maxBudget, available / secondsPerVoiceBlock);
+    }
+
+    int requestedBudget = autoBudget;
+    std::atomic<int> budget { maxBudget };
+
+    // Audio Thread
+    SharedVoiceBudget shared;
+    std::vector<Candidate> candidates; // Reserved in prepare(), never grows on the audio thread
+    size_t nextCandidate = 0;
+    bool candidatesGathered = false;
+    uint64_t blockIndex = 0;
+
+    std::atomic<int> activeVoices { 0 };
+    std::atomic<uint64_t> stolenVoices { 0 };
+};
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+#include <memory>
+#include <vector>
+
+enum class Waveform { sine, saw, square, triangle, wavetable }; // wavetable: the patch's user table, saw without one
+
+// One waveform as band-limited tables, one per octave of pitch. Level k holds the first
+// maxHarmonics >> k harmonics, so an oscillator reading the fullest level whose top harmonic
+// stays below Nyquist never aliases, at the cost of one interpolated read per sample.
+// Immutable once built: any number of voices on any thread may read it.
+class Wavetable
+{
+public:
+    static constexpr int tableSize = 2048;
+    static constexpr int maxHarmonics = 512; // Four points per cycle of the top harmonic keep linear interpolation clean
+    static constexpr int numLevels = 10;     // Down to the fundamental alone
+    static constexpr int maxCycleLength = 8192;
+
+    // Any thread: the four built-in shapes, built on first use and kept for the life of the program.
+    // The VoiceBank asks for them when it is made, so the audio thread never builds one.
+    static const Wavetable& getBuiltin (Waveform type)
+    {
+        static const Wavetable tables[] = { makeBuiltin (Waveform::sine), makeBuiltin (Waveform::saw),
+                                            makeBuiltin (Waveform::square), makeBuiltin (Waveform::triangle) };
+        return tables[type == Waveform::wavetable ? (int) Waveform::saw : (int) type];
+    }
+
+    // Message Thread: a user table from one cycle in an audio file, nullptr with error set if unusable.
+    // A file of whole 2048-frame frames (the usual wavetable layout) contributes its first frame;
+    // any other file is taken as one cycle. Channels are mixed to mono and the peak normalised.
+    static std::shared_ptr<const Wavetable> load (const juce::File& file, juce::AudioFormatManager& formats, juce::String& error)
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader (formats.createReaderFor (file));
+        if (reader == nullptr)
+        {
+            error = file.getFileName() + " is not a readable audio file";
+            return nullptr;
+        }
+
+        const auto length = reader->lengthInSamples;
+        const auto cycleLength = (int) (length >= tableSize && length % tableSize == 0 ? tableSize : length);
+        if (cycleLength < 16 || cycleLength > maxCycleLength)
+        {
+            error = file.getFileName() + " is not a single cycle (16 to " + juce::String (maxCycleLength) + " frames)";
+            return nullptr;
+        }
+
+        juce::AudioBuffer<float> cycle ((int) juce::jlimit (1u, 2u, reader->numChannels), cycleLength);
+        reader->read (&cycle, 0, cycleLength, 0, true, cycle.getNumChannels() > 1);
+        if (cycle.getNumChannels() > 1)
+        {
+            cycle.addFrom (0, 0, cycle, 1, 0, cycleLength);
+            cycle.applyGain (0, 0, cycleLength, 0.5f);
+        }
+
+        // Fourier series of the cycle up to whichever comes first of maxHarmonics and its own Nyquist.
+        // A direct sum over a table of the cycle's angles: exact, and a few million multiplies once.
+        std::vector<double> cosines (maxHarmonics + 1, 0.0), sines (maxHarmonics + 1, 0.0);
+        std::vector<double> cosAngles ((size_t) cycleLength), sinAngles ((size_t) cycleLength);
+        for (int n = 0; n < cycleLength; ++n)
+        {
+            const double angle = juce::MathConstants<double>::twoPi * n / cycleLength;
+            cosAngles[(size_t) n] = std::cos (angle);
+            sinAngles[(size_t) n] = std::sin (angle);
+        }
+
+        const auto* samples = cycle.getReadPointer (0);
+        bool audible = false;
+        for (int h = 1; h <= juce::jmin (maxHarmonics, (cycleLength - 1) / 2); ++h)
+        {
+            double c = 0.0, s = 0.0;
+            for (int n = 0; n < cycleLength; ++n)
+            {
+                const auto index = (size_t) (((juce::int64) h * n) % cycleLength);
+                c += samples[n] * cosAngles[index];
+                s += samples[n] * sinAngles[index];
+            }
+            cosines[(size_t) h] = 2.0 * c / cycleLength;
+            sines[(size_t) h] = 2.0 * s / cycleLength;
+            audible = audible || std::abs (cosines[(size_t) h]) + std::abs (sines[(size_t) h]) > 1.0e-6;
+        }
+
+        if (! audible)
+        {
+            error = file.getFileName() + " has no audible cycle";
+            return nullptr;
+        }
+        return std::shared_ptr<const Wavetable> (new Wavetable (file.getFileNameWithoutExtension(), cosines, sines, true));
+    }
+
+    // The fullest level with every harmonic below Nyquist at increment cycles per sample
+    static int getLevelFor (float increment)
+    {
+        int level = 0;
+        while (level < numLevels - 1 && (float) (maxHarmonics >> level) * increment > 0.5f)
+            ++level;
+        return level;
+    }
+
+    // tableSize points of one cycle, then the first again so an interpolated read never wraps
+    const float* getLevel (int level) const { return data.data() + (size_t) level * levelSize; }
+
+    // phase in cycles, [0, 1)
+    static float read (const float* level, float phase)
+    {
+        const float position = phase * (float) tableSize;
+        const int index = (int) position;
+        const float a = level[index];
+        return a + (position - (float) index) * (level[index + 1] - a);
+    }
+
+    const juce::String& getName() const { return name; }
+
+private:
+    static constexpr int levelSize = tableSize + 1;
+
+    // Harmonic amplitudes indexed by harmonic number, up to maxHarmonics
+    Wavetable (const juce::String& tableName, const std::vector<double>& cosines, const std::vector<double>& sines, bool normalise)
+        : name (tableName), data ((size_t) numLevels * levelSize)
+    {
+        std::vector<double> cosAngles (tableSize), sinAngles (tableSize), sum (tableSize, 0.0);
+        for (int n = 0; n < tableSize; ++n)
+        {
+            const double angle = juce::MathConstants<double>::twoPi * n / tableSize;
+            cosAngles[(size_t) n] = std::cos (angle);
+            sinAngles[(size_t) n] = std::sin (angle);
+        }
+
+        // From the sparsest level up, each adding the harmonics the one above it lacks
+        for (int level = numLevels - 1; level >= 0; --level)
+        {
+            for (int h = (maxHarmonics >> (level + 1)) + 1; h <= (maxHarmonics >> level); ++h)
+            {
+                const double c = cosines[(size_t) h], s = sines[(size_t) h];
+                if (c == 0.0 && s == 0.0) continue;
+                for (int n = 0; n < tableSize; ++n)
+                {
+                    const auto index = (size_t) ((h * n) & (tableSize - 1));
+                    sum[(size_t) n] += c * cosAngles[index] + s * sinAngles[index];
+                }
+            }
+
+            auto* dest = data.data() + (size_t) level * levelSize;
+            for (int n = 0; n < tableSize; ++n)
+                dest[n] = (float) sum[(size_t) n];
+            dest[tableSize] = dest[0];
+        }
+
+        if (normalise)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax (data.data(), levelSize);
+            const float peak = juce::jmax (std::abs (range.getStart()), std::abs (range.getEnd()));
+            if (peak > 0.0f)
+                juce::FloatVectorOperations::multiply (data.data(), 1.0f / peak, (int) data.size());
+        }
+    }
+
+    // The Fourier series of the naive shapes the oscillator used to compute, so levels sound as loud as they did
+    static Wavetable makeBuiltin (Waveform type)
+    {
+        const double pi = juce::MathConstants<double>::pi;
+        std::vector<double> cosines (maxHarmonics + 1, 0.0), sines (maxHarmonics + 1, 0.0);
+
+        for (int h = 1; h <= maxHarmonics; ++h)
+        {
+            const bool odd = (h & 1) != 0;
+            switch (type)
+            {
+                case Waveform::sine:      sines[(size_t) h] = h == 1 ? 1.0 : 0.0; break;
+                case Waveform::saw:       sines[(size_t) h] = -2.0 / (pi * h); break;                 // 2p - 1
+                case Waveform::square:    sines[(size_t) h] = odd ? 4.0 / (pi * h) : 0.0; break;      // +1, then -1
+                case Waveform::triangle:  cosines[(size_t) h] = odd ? 8.0 / (pi * pi * h * h) : 0.0; break; // |4p - 2| - 1
+                case Waveform::wavetable: break;
+            }
+        }
+
+        const char* names[] = { "Sine", "Saw", "Square", "Triangle" };
+        return Wavetable (names[(int) type], cosines, sines, false);
+    }
+
+    juce::String name;
+    std::vector<float> data; // numLevels levels of levelSize, fullest first
+
+    JUCE_DECLARE_NON_COPYABLE (Wavetable)
+};
+
+// User wavetables by file, so every track that loads the same file shares one set of tables.
+// Holds them only as long as some patch does.
+class WavetableLibrary
+{
+public:
+    WavetableLibrary() { formats.registerBasicFormats(); }
+
+    // Message Thread
+    std::shared_ptr<const Wavetable> load (const juce::File& file, juce::String& error)
+    {
+        for (auto it = tables.begin(); it != tables.end();)
+            it = it->second.expired() ? tables.erase (it) : std::next (it);
+
+        const auto key = file.getFullPathName() + "@" + juce::String (file.getLastModificationTime().toMilliseconds());
+        if (auto found = tables.find (key); found != tables.end())
+            if (auto shared = found->second.lock())
+                return shared;
+
+        auto table = Wavetable::load (file, formats, error);
+        if (table != nullptr)
+            tables[key] = table;
+        return table;
+    }
+
+private:
+    juce::AudioFormatManager formats;
+    std::map<juce::String, std::weak_ptr<const Wavetable>> tables;
+
+    JUCE_DECLARE_NON_COPYABLE (WavetableLibrary)
+};